@@ -0,0 +1,155 @@
+/*
+affine.cpp (Copyright 2003 David J. Aronson)
+Units with a zero-point of their own, like degrees Celsius and gauge
+pressure, and converting between them.
+See also affine.hpp, conversion.*, measure.*
+*/
+
+#include "affine.hpp"
+#include "conversion.hpp"
+#include "simd.hpp"
+#include "unitdefs.hpp"
+
+
+// the built-in AffineUnits.  (constant-initialized, like the Units they
+// refer to, so they're good in other files' static initializers too.)
+constinit AffineUnit CELSIUS ("celsius", &KELVIN, 1, 273.15);
+constinit AffineUnit FAHRENHEIT ("fahrenheit", &KELVIN, 5.0 / 9,
+                                 459.67 * 5 / 9);
+constinit AffineUnit GAUGEPASCAL ("gauge pascal", &PASCAL, 1, 101325);
+
+
+// PUBLIC STUFF
+
+
+// Constructors
+
+
+// work out, once, how to get from one to the other
+AffineConversion::AffineConversion (const AffineUnit * f,
+                                    const AffineUnit * t)
+{
+  from = f;
+  to = t;
+  fromUnit = f->GetReference();
+  toUnit = t->GetReference();
+  Plan (fromUnit, f->GetScale(), f->GetOffset(),
+        toUnit, t->GetScale(), t->GetOffset());
+}
+
+
+// (from an absolute quantity in an AffineUnit, to a plain Unit: degrees
+// Celsius to kelvin, say)
+AffineConversion::AffineConversion (const AffineUnit * f, Unit * t)
+{
+  from = f;
+  to = NULL;
+  fromUnit = f->GetReference();
+  toUnit = t;
+  Plan (fromUnit, f->GetScale(), f->GetOffset(), toUnit, 1, 0);
+}
+
+
+AffineConversion::AffineConversion (Unit * f, const AffineUnit * t)
+{
+  from = NULL;
+  to = t;
+  fromUnit = f;
+  toUnit = t->GetReference();
+  Plan (fromUnit, 1, 0, toUnit, t->GetScale(), t->GetOffset());
+}
+
+
+// Member methods
+
+
+// a whole buffer of quantities (out may be the same as q)
+void AffineConversion::Apply (const double * q, double * out, size_t n) const
+{
+  SimdFma (q, factor, offset, out, n);
+}
+
+
+AffineMeasure AffineConversion::Apply (const AffineMeasure & m) const
+{
+  if (m.GetUnit() != from || to == NULL)
+  {
+    throw AffineUnit::MismatchError (m.GetUnit(), from);
+  }
+  return AffineMeasure (Apply (m.GetQuantity()), to);
+}
+
+
+// (for a conversion to a plain Unit)
+Measure AffineConversion::ToMeasure (const AffineMeasure & m) const
+{
+  if (m.GetUnit() != from || to != NULL)
+  {
+    throw AffineUnit::MismatchError (m.GetUnit(), from);
+  }
+  return Measure (Apply (m.GetQuantity()), toUnit);
+}
+
+
+// (for a conversion from a plain Unit)
+AffineMeasure AffineConversion::FromMeasure (const Measure & m) const
+{
+  if (from != NULL) throw AffineUnit::MismatchError (NULL, from);
+  if (*m.GetUnit() != *fromUnit)
+  {
+    throw Unit::MismatchError (m.GetUnit(), fromUnit);
+  }
+  return AffineMeasure (Apply (m.GetQuantity()), to);
+}
+
+
+// an absolute minus an absolute is how far apart they are: a delta, in
+// the reference Unit
+Measure AffineMeasure::operator - (const AffineMeasure & m) const
+{
+  return Measure ((quantity - Mine (m)) * unit->GetScale(),
+                  unit->GetReference());
+}
+
+
+// PROTECTED STUFF
+
+
+// Member methods
+
+
+// one f is fScale fRef's plus fOffset, and one t is tScale tRef's plus
+// tOffset; so q f's are q * factor + offset t's.  this is done in long
+// double, so the two constants come out as close as they can.  throws
+// Conversion::NoPathError if the references can't be converted.
+void AffineConversion::Plan (Unit * fRef, double fScale, double fOffset,
+                             Unit * tRef, double tScale, double tOffset)
+{
+  long double  k = 1;
+
+  if (*fRef != *tRef) k = Conversion::FindFactor (fRef, tRef);
+  factor = (long double) fScale * k / tScale;
+  offset = ((long double) fOffset * k - tOffset) / tScale;
+}
+
+
+// how much of this one's unit a delta d (in the reference Unit) is
+double AffineMeasure::DeltaIn (const Measure & d) const
+{
+  if (*d.GetUnit() != *unit->GetReference())
+  {
+    throw Unit::MismatchError (d.GetUnit(), unit->GetReference());
+  }
+  return d.GetQuantity() / unit->GetScale();
+}
+
+
+// m's quantity, in this one's unit
+double AffineMeasure::Mine (const AffineMeasure & m) const
+{
+  if (m.unit == unit) return m.quantity;
+  return AffineConversion (m.unit, unit).Apply (m.quantity);
+}
+
+
+// END OF FILE
@@ -0,0 +1,176 @@
+/*
+affine.hpp (Copyright 2003 David J. Aronson)
+Units with a zero-point of their own, like degrees Celsius and gauge
+pressure, and converting between them.
+See also affine.cpp, conversion.*, measure.*
+*/
+
+#ifndef AFFINE_H
+#define AFFINE_H
+
+#include <math.h>
+#include <stddef.h>
+#include <string>
+
+#include "measure.hpp"
+#include "unit.hpp"
+
+using namespace std;
+
+
+// An AffineUnit is a scale and an offset from a reference Unit: a
+// quantity q of it is q * scale + offset of the reference.  So CELSIUS
+// is KELVIN with an offset of 273.15, and FAHRENHEIT is KELVIN with a
+// scale of 5/9 and an offset of 459.67 * 5/9.
+//
+// A quantity in an AffineUnit is an absolute one (a temperature, a
+// pressure), kept in an AffineMeasure.  A difference between two of
+// them is a delta, which has no zero-point, so it's a plain Measure, in
+// the reference Unit.  You can add a delta to an absolute, or subtract
+// two absolutes, but not add two absolutes, or scale one.
+class AffineUnit
+{
+public:
+  // Constructors
+  constexpr AffineUnit (string n, Unit * ref, double s, double o)
+                       : name (n), reference (ref), scale (s), offset (o)
+                       { }
+  // Member methods
+  string    GetName (void) const { return name; }
+  Unit *    GetReference (void) const { return reference; }
+  double    GetScale (void) const { return scale; }
+  double    GetOffset (void) const { return offset; }
+  // (a difference of d of these, e.g. FAHRENHEIT.Delta (9) is 5 kelvin)
+  Measure   Delta (double d) const { return Measure (d * scale, reference); }
+  // Exception classes
+  // (an AffineMeasure or conversion used with the wrong AffineUnit; a
+  // Measure in the wrong Unit gets a Unit::MismatchError, as usual)
+  class MismatchError
+  {
+  public:
+    const AffineUnit *u1, *u2;   // u2 is NULL if a plain Unit was wanted
+    MismatchError (const AffineUnit * a, const AffineUnit * b)
+    {
+      u1 = a;
+      u2 = b;
+    }
+  };
+protected:
+  // Member data
+  string    name;
+  Unit *    reference;
+  double    scale;      // one of these is scale references...
+  double    offset;     // ...plus offset, from the reference's zero
+};
+
+
+class AffineMeasure;
+
+
+// How to get from one AffineUnit (or plain Unit, taken as having no
+// offset) to another, worked out once: it's q * factor + offset, which
+// Apply does as a single fused multiply-add, and a whole buffer at a
+// time with vector FMA instructions where the CPU has them.  If the
+// references differ (kelvin and rankine, say), the factor between them
+// comes from Conversion.
+class AffineConversion
+{
+public:
+  // Constructors
+  AffineConversion (const AffineUnit * f, const AffineUnit * t);
+  AffineConversion (const AffineUnit * f, Unit * t);
+  AffineConversion (Unit * f, const AffineUnit * t);
+  // Member methods
+  double         GetFactor (void) const { return factor; }
+  double         GetOffset (void) const { return offset; }
+  double         Apply (double q) const { return fma (q, factor, offset); }
+  void           Apply (const double * q, double * out, size_t n) const;
+  AffineMeasure  Apply (const AffineMeasure & m) const;
+  Measure        ToMeasure (const AffineMeasure & m) const;
+  AffineMeasure  FromMeasure (const Measure & m) const;
+protected:
+  // Member data
+  const AffineUnit *  from;     // NULL if from a plain Unit
+  const AffineUnit *  to;       // NULL if to a plain Unit
+  Unit *              fromUnit;
+  Unit *              toUnit;
+  double              factor;
+  double              offset;
+  // Member methods
+  void  Plan (Unit * fRef, double fScale, double fOffset,
+              Unit * tRef, double tScale, double tOffset);
+};
+
+
+// An absolute quantity in an AffineUnit, e.g. AffineMeasure (20,
+// &CELSIUS).  Like a Measure, it's just a number and a pointer.
+class AffineMeasure
+{
+public:
+  // Constructors
+  constexpr AffineMeasure (void) noexcept : quantity (0), unit (NULL) { }
+  constexpr AffineMeasure (double q, const AffineUnit * u) noexcept
+                          : quantity (q), unit (u) { }
+  // Member methods
+  constexpr double              GetQuantity (void) const noexcept
+                                { return quantity; }
+  constexpr const AffineUnit *  GetUnit (void) const noexcept
+                                { return unit; }
+  // (the same quantity in another AffineUnit, or in the reference Unit)
+  AffineMeasure  In (const AffineUnit * u) const
+                 { return AffineConversion (unit, u).Apply (*this); }
+  Measure        ToMeasure (void) const
+                 {
+                   return Measure (fma (quantity, unit->GetScale(),
+                                        unit->GetOffset()),
+                                   unit->GetReference());
+                 }
+  // absolute - absolute is a delta; absolute +/- delta is an absolute
+  Measure        operator - (const AffineMeasure & m) const;
+  AffineMeasure  operator + (const Measure & d) const
+                 { return AffineMeasure (quantity + DeltaIn (d), unit); }
+  AffineMeasure  operator - (const Measure & d) const
+                 { return AffineMeasure (quantity - DeltaIn (d), unit); }
+  AffineMeasure &  operator += (const Measure & d)
+                   {
+                     quantity += DeltaIn (d);
+                     return *this;
+                   }
+  AffineMeasure &  operator -= (const Measure & d)
+                   {
+                     quantity -= DeltaIn (d);
+                     return *this;
+                   }
+  // (these compare the absolute quantities, even in different units)
+  int  operator == (const AffineMeasure & m) const
+       { return quantity == Mine (m); }
+  int  operator != (const AffineMeasure & m) const
+       { return quantity != Mine (m); }
+  int  operator < (const AffineMeasure & m) const
+       { return quantity < Mine (m); }
+  int  operator > (const AffineMeasure & m) const
+       { return quantity > Mine (m); }
+  int  operator <= (const AffineMeasure & m) const
+       { return quantity <= Mine (m); }
+  int  operator >= (const AffineMeasure & m) const
+       { return quantity >= Mine (m); }
+protected:
+  // Member data
+  double              quantity;
+  const AffineUnit *  unit;
+  // Member methods
+  double  DeltaIn (const Measure & d) const;
+  double  Mine (const AffineMeasure & m) const;
+};
+
+
+// the built-in AffineUnits (see affine.cpp)
+extern AffineUnit CELSIUS;
+extern AffineUnit FAHRENHEIT;
+extern AffineUnit GAUGEPASCAL;  // pascals above one standard atmosphere
+
+
+#endif // ifndef AFFINE_H
+
+
+// END OF FILE
@@ -0,0 +1,1097 @@
+/*
+bench.cpp (Copyright 2003 David J. Aronson)
+Micro and macro benchmarks for the hot paths of Unit and Measure.
+Build with "make bench", run "./bench" (see GiveUsage for options), or
+"make bench.json" for results to compare between releases.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "affine.hpp"
+#include "conversion.hpp"
+#include "formula.hpp"
+#include "measure.hpp"
+#include "measurearray.hpp"
+#include "measureexpr.hpp"
+#include "measurefile.hpp"
+#include "measuredefs.hpp"
+#include "quantitystream.hpp"
+#include "reduction.hpp"
+#include "unit.hpp"
+#include "simd.hpp"
+#include "trajectory.hpp"
+#include "unitdefs.hpp"
+#include "unitparser.hpp"
+
+
+// keeps the optimizer from throwing away results we never look at
+volatile double  sink;
+
+
+// one Report'd result, for the JSON output
+struct Result
+{
+  string  name;
+  long    ops;
+  double  nsPerOp;
+};
+vector <Result>  results;
+
+
+// how many seconds since some arbitrary point
+double Now (void)
+{
+  return chrono::duration <double>
+         (chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// print one result line: name, how many ops, nanoseconds per op
+void Report (string name, long ops, double secs)
+{
+  char  buf[128];
+
+  Result  r;
+
+  sprintf (buf, "%-40s %12ld ops %10.2f ns/op", name.c_str(), ops,
+           secs * 1e9 / ops);
+  cout << buf << endl;
+  r.name = name;
+  r.ops = ops;
+  r.nsPerOp = secs * 1e9 / ops;
+  results.push_back (r);
+}
+
+
+// how the build-up cache has been doing, so far
+void ReportBuildupCache (void)
+{
+  ulong  hits;
+  ulong  misses;
+
+  Unit::GetBuildupCacheStats (&hits, &misses);
+  cout << "(build-up cache: " << hits << " hits, " << misses << " misses)"
+       << endl;
+}
+
+
+// what the hot paths did, if compiled with MEASURE_STATS
+void ReportStats (void)
+{
+  UnitStats  s = Unit::GetStats();
+  int        i;
+
+  if (! s.enabled) return;
+  cout << "(stats:";
+  for (i = 0; i < STATS_COUNTERS; i++)
+  {
+    cout << ' ' << Stats::GetName (i) << ' ' << s.count[i];
+  }
+  cout << " high-water " << s.registryHighWater << ")" << endl;
+}
+
+
+// Grow the unit registry to (at least) a given number of units,
+// by making derived units from powers of the base units.
+// Each (i, j, k) below gives a different unit, so a small cube covers
+// the biggest size we want; we just pick up where we left off.
+void GrowRegistry (Measure * made, int * count, int target)
+{
+  static int  i = -10, j = -10, k = -10;
+  Measure     m = Measure (1, &METER);
+  Measure     s = Measure (1, &SECOND);
+  Measure     kg = Measure (1, &KILOGRAM);
+
+  while (*count < target && i <= 10)
+  {
+    made[(*count)++] = m.power (i) * s.power (j) * kg.power (k);
+    if (++k > 10)
+    {
+      k = -10;
+      if (++j > 10)
+      {
+        j = -10;
+        i++;
+      }
+    }
+  }
+}
+
+
+// multiply throughput, as the registry grows.
+// every product here is of units that already exist, and lands on a
+// unit that already exists, so we time the lookups, not the creations.
+void BenchMultiplyVsRegistrySize (void)
+{
+  static Measure  made[9261];
+  int             count = 0;
+  int             sizes[] = { 20, 100, 1000, 10000 };
+  unsigned        n;
+
+  for (n = 0; n < sizeof (sizes) / sizeof (sizes[0]); n++)
+  {
+    long    i;
+    long    ops = 2000000;
+    double  start;
+    char    name[64];
+
+    GrowRegistry (made, &count, sizes[n]);
+    // warm up: make every product we're about to time
+    for (i = 0; i < 64; i++) made[i % count] * made[(i * 7) % count];
+    start = Now();
+    for (i = 0; i < ops; i++)
+    {
+      sink = (made[(i & 63) % count] * made[((i * 7) & 63) % count])
+             .GetQuantity();
+    }
+    sprintf (name, "multiply, registry of %d+", sizes[n]);
+    Report (name, ops, Now() - start);
+    start = Now();
+    for (i = 0; i < ops; i++)
+    {
+      sink = (double) (size_t) Unit::FindUnitByBuildup
+             (made[(i & 63) % count].GetUnit(), '*',
+              made[((i * 7) & 63) % count].GetUnit());
+    }
+    sprintf (name, "FindUnitByBuildup, registry of %d+", sizes[n]);
+    Report (name, ops, Now() - start);
+    start = Now();
+    for (i = 0; i < ops / 20; i++)
+    {
+      sink = made[i % count].GetUnit()->GetBreakdown().size();
+    }
+    sprintf (name, "GetBreakdown, registry of %d+", sizes[n]);
+    Report (name, ops / 20, Now() - start);
+  }
+  ReportBuildupCache();
+}
+
+
+// making temp units and then reclaiming them, over and over, as a
+// long-running program might.  after the first round, the temps reuse
+// the room the last round's temps had.  (this goes first, since it
+// reclaims every temp, and the other benchmarks keep theirs.)
+void BenchTempChurn (void)
+{
+  const int  rounds = 20;
+  const int  perRound = 5000;
+  int        r;
+  int        i;
+  double     start;
+
+  start = Now();
+  for (r = 0; r < rounds; r++)
+  {
+    Unit *  u = &METER;
+
+    for (i = 0; i < perRound; i++)
+    {
+      u = Unit::FindUnitByBuildup (u, '*', (i & 1) ? &SECOND : &KILOGRAM);
+      if (i % 40 == 39) u = Unit::FindUnitByBuildup (&METER, '*',
+                                                     COULOMB.power (r + 1));
+    }
+    Unit::ReclaimTemps();
+  }
+  Report ("make and reclaim temps", (long) rounds * perRound, Now() - start);
+}
+
+
+// Measure's four basic operations.  + and - check the units match;
+// * and / look up the result's unit (in the build-up cache, after the
+// first time).
+// a tight loop adding up an array of Measures, the way a caller would:
+// with +=, with sum = sum + x, and scaling in place with *=
+void BenchAccumulation (void)
+{
+  const size_t  n = 1 << 16;
+  const int     passes = 64;
+  Measure *     in = new Measure[n];
+  size_t        i;
+  int           p;
+  double        start;
+
+  for (i = 0; i < n; i++) in[i] = Measure (i * 0.25, &METER);
+  start = Now();
+  for (p = 0; p < passes; p++)
+  {
+    Measure  sum = Measure (0, &METER);
+
+    for (i = 0; i < n; i++) sum += in[i];
+    sink = sum.GetQuantity();
+  }
+  Report ("Measure += (accumulate)", n * passes, Now() - start);
+  start = Now();
+  for (p = 0; p < passes; p++)
+  {
+    Measure  sum = Measure (0, &METER);
+
+    for (i = 0; i < n; i++) sum = sum + in[i];
+    sink = sum.GetQuantity();
+  }
+  Report ("Measure = sum + x (accumulate)", n * passes, Now() - start);
+  // (Measures in another Unit of the same dimension check just as fast)
+  {
+    Unit  metre ("metre", &METER, '*', &Unit::UNITLESS);
+
+    for (i = 0; i < n; i++) in[i] = Measure (i * 0.25, &metre);
+    start = Now();
+    for (p = 0; p < passes; p++)
+    {
+      Measure  sum = Measure (0, &METER);
+
+      for (i = 0; i < n; i++) sum += in[i];
+      sink = sum.GetQuantity();
+    }
+    Report ("Measure += (same dimension, other Unit)", n * passes,
+            Now() - start);
+  }
+  start = Now();
+  for (p = 0; p < passes; p++)
+  {
+    Measure  sum = Measure (1, &METER);
+
+    for (i = 0; i < n; i++) sum *= 1.0000001;
+    sink = sum.GetQuantity();
+  }
+  Report ("Measure *= double", n * passes, Now() - start);
+  delete [] in;
+}
+
+
+void BenchMeasureArithmetic (void)
+{
+  const long  ops = 5000000;
+  Measure     a = Measure (1.5, &METER);
+  Measure     b = Measure (2.5, &METER);
+  Measure     t = Measure (0.5, &SECOND);
+  long        i;
+  double      start;
+
+  start = Now();
+  for (i = 0; i < ops; i++) sink = (a + b).GetQuantity();
+  Report ("Measure +", ops, Now() - start);
+  start = Now();
+  for (i = 0; i < ops; i++) sink = (a - b).GetQuantity();
+  Report ("Measure -", ops, Now() - start);
+  start = Now();
+  for (i = 0; i < ops; i++) sink = (a * t).GetQuantity();
+  Report ("Measure *", ops, Now() - start);
+  start = Now();
+  for (i = 0; i < ops; i++) sink = (a / t).GetQuantity();
+  Report ("Measure /", ops, Now() - start);
+  start = Now();
+  for (i = 0; i < ops; i++) sink = (a * 2.0).GetQuantity();
+  Report ("Measure * double", ops, Now() - start);
+  BenchAccumulation();
+}
+
+
+// checking input where some of it's bad: adding with + and catching
+// the MismatchError, adding with TryAdd, and Validate'ing it all first
+void BenchValidation (void)
+{
+  const size_t  n = 1 << 20;
+  Measure *     in;
+  uint64_t *    bad = new uint64_t[(n + 63) / 64];
+  Measure       total = Measure (0, &METER);
+  Measure       sum;
+  size_t        i;
+  long          mismatches;
+  double        start;
+  char          name[64];
+  int           pct;
+
+  for (pct = 0; pct <= 10; pct += 10)
+  {
+    in = new Measure[n];
+    for (i = 0; i < n; i++)
+    {
+      in[i] = Measure (1, ((int) (i % 100) < pct) ? &SECOND : &METER);
+    }
+    start = Now();
+    for (mismatches = 0, i = 0; i < n; i++)
+    {
+      try { sink = (total + in[i]).GetQuantity(); }
+      catch (Unit::MismatchError) { mismatches++; }
+    }
+    sprintf (name, "+ and catch, %d%% bad", pct);
+    Report (name, n, Now() - start);
+    start = Now();
+    for (mismatches = 0, i = 0; i < n; i++)
+    {
+      if (total.TryAdd (in[i], &sum) == MEASURE_OK) sink = sum.GetQuantity();
+      else mismatches++;
+    }
+    sprintf (name, "TryAdd, %d%% bad", pct);
+    Report (name, n, Now() - start);
+    start = Now();
+    sink = Measure::Validate (in, n, &METER, bad);
+    sprintf (name, "Validate, %d%% bad", pct);
+    Report (name, n, Now() - start);
+    delete [] in;
+  }
+  delete [] bad;
+}
+
+
+// the same bulk work on Measures and on FloatMeasures, which are half
+// the size and do their arithmetic in float: scaling in place (which
+// the compiler can vectorize), adding up, and Validate
+template <class M> void BenchPrecisionOf (const char * type)
+{
+  const size_t  n = 1 << 20;
+  const int     reps = 20;
+  M *           in = new M[n];
+  uint64_t *    bad = new uint64_t[(n + 63) / 64];
+  size_t        i;
+  int           r;
+  double        start;
+  char          name[64];
+
+  for (i = 0; i < n; i++) in[i] = M (i % 1000 * 0.25, &METER);
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++) in[i] *= (r & 1) ? 2 : 0.5;
+  }
+  sink = in[n / 2].GetQuantity();
+  sprintf (name, "%s *= number", type);
+  Report (name, n * reps, Now() - start);
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    M  sum = M (0, &METER);
+
+    for (i = 0; i < n; i++) sum += in[i];
+    sink = sum.GetQuantity();
+  }
+  sprintf (name, "%s += (accumulate)", type);
+  Report (name, n * reps, Now() - start);
+  start = Now();
+  for (r = 0; r < reps; r++) sink = M::Validate (in, n, &METER, bad);
+  sprintf (name, "%s Validate", type);
+  Report (name, n * reps, Now() - start);
+  delete [] in;
+  delete [] bad;
+}
+
+
+void BenchPrecision (void)
+{
+  BenchPrecisionOf <Measure> ("Measure");
+  BenchPrecisionOf <FloatMeasure> ("FloatMeasure");
+}
+
+
+// Measure powers and roots, including the Unit lookups they do
+void BenchPowerAndRoot (void)
+{
+  const long  ops = 2000000;
+  Measure     t = Measure (1.0001, &SECOND);
+  Measure     a = Measure (2.5, &M2);
+  Measure     v = Measure (8.5, SECOND.power (3));
+  int         pows[] = { 2, 3, 12, -5 };
+  unsigned    n;
+  long        i;
+  double      start;
+  char        name[64];
+
+  for (n = 0; n < sizeof (pows) / sizeof (pows[0]); n++)
+  {
+    t.power (pows[n]);
+    start = Now();
+    for (i = 0; i < ops; i++) sink = t.power (pows[n]).GetQuantity();
+    sprintf (name, "Measure power (%d)", pows[n]);
+    Report (name, ops, Now() - start);
+  }
+  start = Now();
+  for (i = 0; i < ops; i++) sink = a.root (2).GetQuantity();
+  Report ("Measure root (2)", ops, Now() - start);
+  start = Now();
+  for (i = 0; i < ops; i++) sink = v.root (3).GetQuantity();
+  Report ("Measure root (3)", ops, Now() - start);
+}
+
+
+// converting: the old way (multiply by a CONVERT_* Measure, and assign
+// to check the unit), the engine's per-thread cache, and a Conversion
+// that's been planned ahead of time
+void BenchConversion (void)
+{
+  const long  ops = 2000000;
+  Measure     m = Measure (1.5, &MpS);
+  Measure     out = Measure (Unit::FindUnitByName ("fps"));
+  Conversion  cvt (&MpS, Unit::FindUnitByName ("fps"));
+  long        i;
+  double      start;
+
+  start = Now();
+  for (i = 0; i < ops; i++)
+  {
+    out = m * CONVERT_FEETPERMETER;
+    sink = out.GetQuantity();
+  }
+  Report ("convert by CONVERT_* Measure", ops, Now() - start);
+  start = Now();
+  for (i = 0; i < ops; i++)
+  {
+    sink = Conversion::Convert (m, out.GetUnit()).GetQuantity();
+  }
+  Report ("Conversion::Convert", ops, Now() - start);
+  start = Now();
+  for (i = 0; i < ops; i++) sink = cvt.Apply (m).GetQuantity();
+  Report ("Conversion::Apply (Measure)", ops, Now() - start);
+  start = Now();
+  for (i = 0; i < ops; i++) sink = cvt.Apply (m.GetQuantity());
+  Report ("Conversion::Apply (double)", ops, Now() - start);
+}
+
+
+// converting temperatures: one at a time, a buffer at a time as a
+// multiply pass then an add pass, and a buffer at a time as one fused
+// multiply-add pass
+void BenchAffine (void)
+{
+  const size_t      n = 1 << 16;
+  const int         reps = 200;
+  AffineConversion  cvt (&CELSIUS, &FAHRENHEIT);
+  double *          in = new double[n];
+  double *          out = new double[n];
+  size_t            i;
+  int               r;
+  double            start;
+
+  for (i = 0; i < n; i++) in[i] = i * 0.001 - 20;
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++) out[i] = cvt.Apply (in[i]);
+    sink = out[r];
+  }
+  Report ("affine, one at a time", n * reps, Now() - start);
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    SimdMulScalar (in, cvt.GetFactor(), out, n);
+    SimdAddScalar (out, cvt.GetOffset(), out, n);
+    sink = out[r];
+  }
+  Report ("affine, multiply then add passes", n * reps, Now() - start);
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    cvt.Apply (in, out, n);
+    sink = out[r];
+  }
+  Report ("affine, fused (buffer)", n * reps, Now() - start);
+  delete [] in;
+  delete [] out;
+}
+
+
+// adding up lots of Measures: a loop of +=, then Reduction on pools of
+// 1, 2, 4... threads, up to one per CPU
+void BenchReductions (void)
+{
+  const size_t  n = 1 << 21;
+  const int     reps = 10;
+  MeasureArray  dist (&METER, n);
+  MeasureArray  force (&NEWTON, n);
+  Measure *     each = new Measure[n];
+  int           cpus = thread::hardware_concurrency();
+  int           threads;
+  size_t        i;
+  int           r;
+  double        start;
+  char          name[64];
+
+  for (i = 0; i < n; i++)
+  {
+    dist.GetQuantities()[i] = i * 0.5;
+    force.GetQuantities()[i] = 2;
+    each[i] = Measure (i * 0.5, &METER);
+  }
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    Measure  sum = Measure (0, &METER);
+
+    for (i = 0; i < n; i++) sum += each[i];
+    sink = sum.GetQuantity();
+  }
+  Report ("sum, loop of Measure +=", n * reps, Now() - start);
+  // (1, 2, 4..., and one per CPU, if that's not a power of two)
+  for (threads = 1; threads <= max (cpus, 1);
+       threads = (threads < cpus && threads * 2 > cpus) ? cpus : threads * 2)
+  {
+    ThreadPool  pool (threads);
+
+    start = Now();
+    for (r = 0; r < reps; r++)
+    {
+      sink = Reduction::Sum (dist, &pool).GetQuantity();
+    }
+    sprintf (name, "Reduction::Sum (array), %d threads", threads);
+    Report (name, n * reps, Now() - start);
+    start = Now();
+    for (r = 0; r < reps; r++)
+    {
+      sink = Reduction::Sum (each, n, &pool).GetQuantity();
+    }
+    sprintf (name, "Reduction::Sum (Measure *), %d threads", threads);
+    Report (name, n * reps, Now() - start);
+    start = Now();
+    for (r = 0; r < reps; r++)
+    {
+      sink = Reduction::Dot (dist, force, &pool).GetQuantity();
+    }
+    sprintf (name, "Reduction::Dot, %d threads", threads);
+    Report (name, n * reps, Now() - start);
+  }
+  delete [] each;
+}
+
+
+// the same element-wise work, done as a loop over Measures, and then
+// as MeasureArray operations (which check units once per array).
+// outputs are made fresh for each test, since each has its own unit.
+void BenchMeasureArray (void)
+{
+  const size_t  n = 1 << 20;
+  const int     reps = 20;
+  MeasureArray  da (&METER, n);
+  MeasureArray  db (&METER, n);
+  MeasureArray  dt (&SECOND, n);
+  MeasureArray  dt2;
+  Measure *     ma = new Measure[n];
+  Measure *     mb = new Measure[n];
+  Measure *     mt = new Measure[n];
+  Measure *     mo;
+  size_t        i;
+  int           r;
+  double        start;
+
+  for (i = 0; i < n; i++)
+  {
+    da.GetQuantities()[i] = db.GetQuantities()[i] = 1.0 + i % 1000;
+    dt.GetQuantities()[i] = 0.5 + i % 100;
+    ma[i] = da.Get (i);
+    mb[i] = db.Get (i);
+    mt[i] = dt.Get (i);
+  }
+  dt2 = dt.power (2);
+  cout << "(MeasureArray kernels using " << SimdGetLevel() << ")" << endl;
+
+  mo = new Measure[n];
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++) mo[i] = ma[i] + mb[i];
+  }
+  Report ("Measure loop, +", n * reps, Now() - start);
+  delete [] mo;
+  {
+    MeasureArray  out;
+    start = Now();
+    for (r = 0; r < reps; r++) out = da + db;
+    Report ("MeasureArray, +", n * reps, Now() - start);
+    start = Now();
+    for (r = 0; r < reps; r++) out += db;
+    Report ("MeasureArray, +=", n * reps, Now() - start);
+  }
+
+  mo = new Measure[n];
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++) mo[i] = ma[i] / mt[i];
+  }
+  Report ("Measure loop, /", n * reps, Now() - start);
+  delete [] mo;
+  {
+    MeasureArray  out;
+    start = Now();
+    for (r = 0; r < reps; r++) out = da / dt;
+    Report ("MeasureArray, /", n * reps, Now() - start);
+  }
+
+  mo = new Measure[n];
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++) mo[i] = mt[i].power (3);
+  }
+  Report ("Measure loop, power (3)", n * reps, Now() - start);
+  delete [] mo;
+  {
+    MeasureArray  out;
+    start = Now();
+    for (r = 0; r < reps; r++) out = dt.power (3);
+    Report ("MeasureArray, power (3)", n * reps, Now() - start);
+  }
+
+  mo = new Measure[n];
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++) mo[i] = mt[i].power (2).root (2);
+  }
+  Report ("Measure loop, power (2).root (2)", n * reps, Now() - start);
+  delete [] mo;
+  {
+    MeasureArray  out;
+    start = Now();
+    for (r = 0; r < reps; r++) out = dt.power (2).root (2);
+    Report ("MeasureArray, power (2).root (2)", n * reps, Now() - start);
+  }
+
+  delete [] ma;
+  delete [] mb;
+  delete [] mt;
+}
+
+
+// falltime's and falldist's formulas, one Measure at a time as the
+// single-answer modes do them, and a whole array at a time as the batch
+// modes do
+void BenchFalling (void)
+{
+  const size_t  n = 1 << 20;
+  const int     reps = 10;
+  MeasureArray  heights (&METER, n);
+  MeasureArray  times (&SECOND, n);
+  size_t        i;
+  int           r;
+  double        start;
+
+  for (i = 0; i < n; i++)
+  {
+    heights.GetQuantities()[i] = 0.5 + i % 1000;
+    times.GetQuantities()[i] = 0.25 + i % 100;
+  }
+
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++)
+    {
+      sink = (heights.Get (i) * 2.0 / G).root (2).GetQuantity();
+    }
+  }
+  Report ("fall time, Measure at a time", n * reps, Now() - start);
+  start = Now();
+  for (r = 0; r < reps; r++) sink = FallTimes (heights, G).GetQuantities()[0];
+  Report ("fall time, FallTimes", n * reps, Now() - start);
+
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++)
+    {
+      sink = (G * 0.5 * times.Get (i).power (2)).GetQuantity();
+    }
+  }
+  Report ("fall distance, Measure at a time", n * reps, Now() - start);
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    sink = FallDistances (times, G).GetQuantities()[0];
+  }
+  Report ("fall distance, FallDistances", n * reps, Now() - start);
+  // (the same, as lazy expressions: see measureexpr.hpp)
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    for (i = 0; i < n; i++)
+    {
+      Measure  d = Lazy (G) * 0.5 * Lazy (times.Get (i)).power <2> ();
+
+      sink = d.GetQuantity();
+    }
+  }
+  Report ("fall distance, lazy Measure at a time", n * reps, Now() - start);
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    sink = (times.power (2) * G * 0.5).GetQuantities()[0];
+  }
+  Report ("fall distance, MeasureArray operators", n * reps, Now() - start);
+  start = Now();
+  for (r = 0; r < reps; r++)
+  {
+    MeasureArray  d = Lazy (G) * 0.5 * Lazy (times).power <2> ();
+
+    sink = d.GetQuantities()[0];
+  }
+  Report ("fall distance, lazy MeasureArray", n * reps, Now() - start);
+
+  {
+    Formula  f ("sqrt (2*d/G)");
+
+    f.BindConstant ("G", G);
+    f.BindVariable ("d", &METER);
+    f.Compile();
+    start = Now();
+    for (r = 0; r < reps; r++)
+    {
+      for (i = 0; i < n; i++)
+      {
+        sink = f.Evaluate (&heights.GetQuantities()[i]);
+      }
+    }
+    Report ("fall time, Formula on doubles", n * reps, Now() - start);
+    start = Now();
+    for (r = 0; r < reps; r++)
+    {
+      for (i = 0; i < n; i++)
+      {
+        Measure  h = heights.Get (i);
+        sink = f.Evaluate (&h).GetQuantity();
+      }
+    }
+    Report ("fall time, Formula on Measures", n * reps, Now() - start);
+    start = Now();
+    for (r = 0; r < reps; r++) sink = f.Evaluate (&heights).GetQuantities()[0];
+    Report ("fall time, Formula on MeasureArray", n * reps, Now() - start);
+  }
+}
+
+
+// parsing unit strings like a config file or data header would have
+// them: each pass over the corpus first adds an alias (which empties
+// every thread's cache), for the cold numbers; then the same corpus
+// again and again, for the cached ones.  FindUnitByName, which only
+// knows whole names, is the old way to get a Unit from a string.
+void BenchUnitStrings (void)
+{
+  const char *  corpus[] = { "m", "s", "kg", "m/s", "m/s^2", "kg*m/s^2",
+                             "N*m", "J/s", "kg*m^2/s^3", "ft/(s*s)",
+                             "ft*lbf", "1/s", "s^-2", "kg/m^3",
+                             "N/m^2", "(kg*m/s^2)*(m/s)" };
+  const int     n = sizeof (corpus) / sizeof (corpus[0]);
+  const long    passes = 20000;
+  string        strings[n];
+  string        alias = "bench-alias";
+  ulong         hits;
+  ulong         misses;
+  long          i;
+  int           j;
+  double        start;
+
+  for (j = 0; j < n; j++) strings[j] = corpus[j];
+  start = Now();
+  for (i = 0; i < passes; i++)
+  {
+    for (j = 0; j < n; j++) sink = Unit::FindUnitByName (strings[j]) != NULL;
+  }
+  Report ("FindUnitByName (corpus)", passes * n, Now() - start);
+  start = Now();
+  for (i = 0; i < passes / 10; i++)
+  {
+    UnitParser::AddAlias (alias, &METER);
+    for (j = 0; j < n; j++) sink = UnitParser::Parse (strings[j]) != NULL;
+  }
+  Report ("UnitParser::Parse, cold (corpus)", passes / 10 * n, Now() - start);
+  start = Now();
+  for (i = 0; i < passes; i++)
+  {
+    for (j = 0; j < n; j++) sink = UnitParser::Parse (strings[j]) != NULL;
+  }
+  Report ("UnitParser::Parse, cached (corpus)", passes * n, Now() - start);
+  UnitParser::GetCacheStats (&hits, &misses);
+  cout << "(unit string cache: " << hits << " hits, " << misses
+       << " misses)" << endl;
+}
+
+
+// saving and reloading lots of Measures: as text (printed, then read
+// back with strtod), which was all there was, and as measure files, in
+// records and in columns.  reading a column is mapping the file and
+// summing the view in place.
+void BenchMeasureFiles (void)
+{
+  const size_t  n = 1 << 22;
+  const char *  path = "/tmp/bench-measures";
+  MeasureArray  a (&METER, n);
+  size_t        i;
+  double        start;
+  double        sum;
+
+  for (i = 0; i < n; i++) a.GetQuantities()[i] = 1.0 + (i % 1000) / 7.0;
+  {
+    FILE *  f = fopen (path, "w");
+    char    line[64];
+
+    start = Now();
+    for (i = 0; i < n; i++)
+    {
+      fprintf (f, "%.17g meter\n", a.Get (i).GetQuantity());
+    }
+    fclose (f);
+    Report ("text, write", n, Now() - start);
+    start = Now();
+    f = fopen (path, "r");
+    for (sum = 0; fgets (line, sizeof (line), f) != NULL; )
+    {
+      char *   end;
+      Measure  m = Measure (strtod (line, &end),
+                            Unit::FindUnitByName ("meter"));
+      sum += m.GetQuantity();
+    }
+    fclose (f);
+    sink = sum;
+    Report ("text, read", n, Now() - start);
+  }
+  {
+    MeasureWriter  w (path);
+
+    start = Now();
+    for (i = 0; i < n; i++) w.Write (a.Get (i));
+    w.Close();
+    Report ("measure file records, write", n, Now() - start);
+  }
+  {
+    start = Now();
+    MeasureReader  r (path);
+    for (sum = 0; ! r.AtEnd(); ) sum += r.Next().GetQuantity();
+    sink = sum;
+    Report ("measure file records, read", n, Now() - start);
+  }
+  {
+    MeasureWriter  w (path);
+
+    start = Now();
+    w.Write (a);
+    w.Close();
+    Report ("measure file column, write", n, Now() - start);
+  }
+  {
+    start = Now();
+    MeasureReader  r (path);
+    MeasureView    v = r.GetColumn (0);
+    for (sum = 0, i = 0; i < v.GetSize(); i++) sum += v.GetQuantities()[i];
+    sink = sum;
+    Report ("measure file column, map and sum", n, Now() - start);
+  }
+  unlink (path);
+}
+
+
+// making base units (each looks for the next prime; see Unit (name)).
+// there's only room for MAXBASEUNITS of them in all, so this can only
+// make what's left, and has to go last.
+void BenchBaseUnits (void)
+{
+  vector <Unit *>  made;
+  size_t           i;
+  double           start;
+  char             name[32];
+
+  start = Now();
+  for (i = 0; ; i++)
+  {
+    sprintf (name, "benchbase%zu", i);
+    try { made.push_back (new Unit (name)); }
+    catch (Unit::BaseUnitLimitError) { break; }
+  }
+  if (made.empty()) return;
+  Report ("startup: make a base unit", made.size(), Now() - start);
+  // a named rate for each, as a unit system would declare next
+  start = Now();
+  for (i = 0; i < made.size(); i++)
+  {
+    sprintf (name, "benchrate%zu", i);
+    new Unit (name, made[i], '/', &SECOND);
+  }
+  Report ("startup: make a derived unit", made.size(), Now() - start);
+  start = Now();
+  sink = Unit::GetAllBreakdowns().size();
+  Report ("startup: GetAllBreakdowns", 1, Now() - start);
+}
+
+
+// the sample programs' -s modes, on a buffer of numbers like the files
+// they'd be given, to /dev/null
+void BenchPrograms (void)
+{
+  const size_t  n = 1 << 20;
+  string        text;
+  Conversion    cvt (&METER, &FOOT);
+  FILE *        out = fopen ("/dev/null", "w");
+  string        bad;
+  size_t        i;
+  char          buf[32];
+
+  for (i = 0; i < n; i++)
+  {
+    sprintf (buf, "%g\n", 0.5 + (i % 10000) / 8.0);
+    text += buf;
+  }
+  struct
+  {
+    const char *   name;
+    ChunkFunction  f;
+  } programs[] =
+  {
+    { "cvtunits -s m ft", [&cvt] (MeasureArray & a) { return cvt.Apply (a); } },
+    { "falltime -s", [] (MeasureArray & a) { return FallTimes (a, G); } },
+    { "falldist -s", [] (MeasureArray & a) { return FallDistances (a, G); } }
+  };
+  for (i = 0; i < sizeof (programs) / sizeof (programs[0]); i++)
+  {
+    FILE *  in = fmemopen ((void *) text.data(), text.size(), "r");
+    Unit *  u = (i == 2) ? &SECOND : &METER;
+    double  start = Now();
+
+    StreamQuantities (in, out, u, programs[i].f, 0, &bad);
+    Report (programs[i].name, n, Now() - start);
+    fclose (in);
+  }
+  fclose (out);
+}
+
+
+// the benchmarks, in the order they run.  BenchTempChurn goes first,
+// since it reclaims every temp, and BenchBaseUnits last, since it uses
+// up the base unit slots.
+struct
+{
+  const char *  name;
+  void          (*f) (void);
+} benches[] =
+{
+  { "temps", BenchTempChurn },
+  { "registry", BenchMultiplyVsRegistrySize },
+  { "arithmetic", BenchMeasureArithmetic },
+  { "validation", BenchValidation },
+  { "precision", BenchPrecision },
+  { "powers", BenchPowerAndRoot },
+  { "conversion", BenchConversion },
+  { "affine", BenchAffine },
+  { "unitstrings", BenchUnitStrings },
+  { "arrays", BenchMeasureArray },
+  { "reductions", BenchReductions },
+  { "files", BenchMeasureFiles },
+  { "falling", BenchFalling },
+  { "programs", BenchPrograms },
+  { "baseunits", BenchBaseUnits }
+};
+
+
+void GiveUsage (void)
+{
+  unsigned  i;
+
+  cerr << "Usage: bench [-j file] [name ...]" << endl;
+  cerr << "Runs the named benchmarks (or all of them), printing" << endl;
+  cerr << "the results; with -j, also writes them to file as JSON," << endl;
+  cerr << "in Google Benchmark's format, for comparing runs." << endl;
+  cerr << "The benchmarks are:" << endl;
+  for (i = 0; i < sizeof (benches) / sizeof (benches[0]); i++)
+  {
+    cerr << "  " << benches[i].name << endl;
+  }
+  exit (1);
+}
+
+
+// a string, quoted for JSON (our names have nothing that needs escaping
+// but quotes and backslashes)
+string Quote (string s)
+{
+  string    q = "\"";
+  unsigned  i;
+
+  for (i = 0; i < s.size(); i++)
+  {
+    if (s[i] == '"' || s[i] == '\\') q += '\\';
+    q += s[i];
+  }
+  return q + '"';
+}
+
+
+// all the results so far, as Google Benchmark would write them
+void WriteJson (FILE * f)
+{
+  time_t    now = time (NULL);
+  char      date[64];
+  unsigned  i;
+
+  strftime (date, sizeof (date), "%Y-%m-%dT%H:%M:%S%z", localtime (&now));
+  fprintf (f, "{\n  \"context\": {\n");
+  fprintf (f, "    \"date\": %s,\n", Quote (date).c_str());
+  fprintf (f, "    \"executable\": \"bench\",\n");
+  fprintf (f, "    \"compiler\": %s,\n", Quote (__VERSION__).c_str());
+  fprintf (f, "    \"simd\": %s\n", Quote (SimdGetLevel()).c_str());
+  fprintf (f, "  },\n  \"benchmarks\": [");
+  for (i = 0; i < results.size(); i++)
+  {
+    fprintf (f, "%s\n    {\n", (i == 0) ? "" : ",");
+    fprintf (f, "      \"name\": %s,\n", Quote (results[i].name).c_str());
+    fprintf (f, "      \"run_type\": \"iteration\",\n");
+    fprintf (f, "      \"iterations\": %ld,\n", results[i].ops);
+    fprintf (f, "      \"real_time\": %.4f,\n", results[i].nsPerOp);
+    fprintf (f, "      \"time_unit\": \"ns\"\n    }");
+  }
+  fprintf (f, "\n  ]\n}\n");
+}
+
+
+int main (int argc, char * argv[])
+{
+  const char *  json = NULL;
+  int           first = 1;
+  int           i;
+  unsigned      b;
+
+  if (argc >= 3 && strcmp (argv[1], "-j") == 0)
+  {
+    json = argv[2];
+    first = 3;
+  }
+  else if (argc >= 2 && argv[1][0] == '-') GiveUsage();
+  for (i = first; i < argc; i++)
+  {
+    for (b = 0; b < sizeof (benches) / sizeof (benches[0]); b++)
+    {
+      if (strcmp (argv[i], benches[b].name) == 0) break;
+    }
+    if (b == sizeof (benches) / sizeof (benches[0])) GiveUsage();
+  }
+  for (b = 0; b < sizeof (benches) / sizeof (benches[0]); b++)
+  {
+    int  wanted = (first == argc);
+
+    for (i = first; i < argc; i++)
+    {
+      if (strcmp (argv[i], benches[b].name) == 0) wanted = 1;
+    }
+    if (wanted) benches[b].f();
+  }
+  ReportStats();
+  if (json != NULL)
+  {
+    FILE *  f = fopen (json, "w");
+
+    if (f == NULL)
+    {
+      perror (json);
+      return 1;
+    }
+    WriteJson (f);
+    fclose (f);
+  }
+  return 0;
+}
+
+
+// END OF FILE
@@ -0,0 +1,295 @@
+/*
+conversion.cpp (Copyright 2003 David J. Aronson)
+Converting Measures between Units of the same kind (feet and meters, say),
+using conversion factors registered once.
+See also conversion.hpp, measure.*
+*/
+
+#include <math.h>
+#include <deque>
+
+#include "conversion.hpp"
+#include "measuredefs.hpp"
+#include "simd.hpp"
+#include "unitdefs.hpp"
+
+
+mutex           Conversion::graphLock;
+vector <Conversion::Edge>  Conversion::edges;
+atomic <ulong>  Conversion::graphEpoch (1);
+
+
+// the built-in conversion factors (see measuredefs.hpp).  these are added
+// the first time anybody looks for a factor, not when the program
+// starts, so they don't depend on measure.o's statics being made first.
+static once_flag  builtInFactors;
+
+static void AddBuiltInFactors (void)
+{
+  Conversion::AddFactor (&METER, &FOOT, CONVERT_FEETPERMETER);
+  Conversion::AddFactor (&KILOGRAM, &SLUG, CONVERT_SLUGSPERKILOGRAM);
+  // (INCH, YARD and MILE are base units of their own, so these are all
+  // that relate them to FOOT, and so to everything else)
+  Conversion::AddFactor (&INCH, &FOOT, 1.0 / 12);
+  Conversion::AddFactor (&YARD, &FOOT, 3);
+  Conversion::AddFactor (&MILE, &FOOT, 5280);
+}
+
+
+// PUBLIC STUFF
+
+
+// Constructors
+
+
+// work out, once, how to get from one unit to another
+Conversion::Conversion (Unit * f, Unit * t)
+{
+  from = f;
+  to = t;
+  factor = FindFactor (f, t);
+}
+
+
+// Member methods
+
+
+Measure Conversion::Apply (Measure m)
+{
+  return Measure (m.GetQuantity() * factor, CheckFrom (m.GetUnit()));
+}
+
+
+// the whole array, with one unit check (before the result is made, all
+// of which is then written at once)
+MeasureArray Conversion::Apply (MeasureArray & a)
+{
+  MeasureArray  result (CheckFrom (a.GetUnit()), a.GetSize(),
+                        MeasureArray::NOINIT);
+
+  SimdMulScalar (a.GetQuantities(), factor, result.GetQuantities(),
+                 a.GetSize());
+  return result;
+}
+
+
+// Static methods
+
+
+// say that one f is factor t's, e.g., AddFactor (&METER, &FOOT, 3.28).
+// this works the other way too, so there's no need to add foot -> meter.
+void Conversion::AddFactor (Unit * f, Unit * t, double factor)
+{
+  Edge                e;
+  lock_guard <mutex>  lock (graphLock);
+
+  e.from = f->GetDimension();
+  e.to = t->GetDimension();
+  e.factor = factor;
+  edges.push_back (e);
+  graphEpoch++;
+}
+
+
+// the same, from a Measure in t's per f, like CONVERT_FEETPERMETER
+void Conversion::AddFactor (Unit * f, Unit * t, Measure factor)
+{
+  Unit *  u = Unit::FindUnitByBuildup (t, '/', f);
+
+  if (*factor.GetUnit() != *u) throw Unit::MismatchError (factor.GetUnit(), u);
+  AddFactor (f, t, factor.GetQuantity());
+}
+
+
+// convert a Measure to another unit.  each thread remembers the last
+// few factors it used, so doing the same conversion again is a lookup
+// and a multiply.
+Measure Conversion::Convert (Measure m, Unit * target)
+{
+  static thread_local CacheEntry  cache[CONVERSIONCACHESIZE];
+  Dimension     f = m.GetUnit()->GetDimension();
+  Dimension     t = target->GetDimension();
+  CacheEntry *  c = &cache[(f.Hash() * 31 + t.Hash()) % CONVERSIONCACHESIZE];
+  ulong         epoch = graphEpoch.load (memory_order_acquire);
+
+  if (c->epoch != epoch || c->from != f || c->to != t)
+  {
+    c->factor = FindFactor (m.GetUnit(), target);
+    c->from = f;
+    c->to = t;
+    c->epoch = epoch;
+  }
+  return Measure (m.GetQuantity() * c->factor, target);
+}
+
+
+// how many t's one f is.  throws NoPathError if the known factors
+// don't get us there.
+double Conversion::FindFactor (Unit * f, Unit * t)
+{
+  double  fac;
+
+  call_once (builtInFactors, AddBuiltInFactors);
+  lock_guard <mutex>  lock (graphLock);
+  if (! Plan (f->GetDimension(), t->GetDimension(), &fac))
+  {
+    throw NoPathError (f, t);
+  }
+  return fac;
+}
+
+
+// PROTECTED STUFF
+
+
+// Member methods
+
+
+// make sure what's being converted is in from (a Measure of no Unit yet
+// isn't), and give back the Unit it'll be converted to
+Unit * Conversion::CheckFrom (Unit * u)
+{
+  if (u == NULL || *u != *from) throw Unit::MismatchError (u, from);
+  return to;
+}
+
+
+// Static methods
+
+
+// find the multiplier from f to t: first by a path in the graph, and
+// failing that, by breaking both down to base units.  (caller locks)
+int Conversion::Plan (const Dimension & f, const Dimension & t, double * fac)
+{
+  Dimension  found;
+  Dimension  fCanon;
+  Dimension  tCanon;
+  double     fScale;
+  double     tScale;
+
+  if (f == t)
+  {
+    *fac = 1;
+    return 1;
+  }
+  if (Search (f, [&t] (const Dimension & d) { return d == t; },
+              &found, fac)) return 1;
+  if (! Decompose (f, &fCanon, &fScale) || ! Decompose (t, &tCanon, &tScale))
+  {
+    return 0;
+  }
+  if (fCanon != tCanon) return 0;
+  *fac = fScale / tScale;
+  return 1;
+}
+
+
+// Rewrite d in terms of "canonical" base units: each base unit that has
+// a factor to something made only of base units declared before it, is
+// replaced by that (so foot becomes 0.3048 meter, but meter stays).
+// Since each step only goes to earlier base units, this always ends.
+// one d is scale canons.  (caller locks)
+int Conversion::Decompose (const Dimension & d, Dimension * canon,
+                           double * scale)
+{
+  int        slot;
+  Dimension  result;
+  double     s = 1;
+
+  for (slot = MAXBASEUNITS - 1; slot >= 0; slot--)
+  {
+    int        e = d.GetExponent (slot);
+    Dimension  part = Dimension::Base (slot);
+    double     partScale = 1;
+    Dimension  found;
+    double     fac;
+
+    if (e == 0) continue;
+    // anything made only of slots before this one will do
+    if (Search (Dimension::Base (slot),
+                [slot] (const Dimension & x)
+                {
+                  int  i;
+                  for (i = slot; i < MAXBASEUNITS; i++)
+                  {
+                    if (x.GetExponent (i) != 0) return 0;
+                  }
+                  return 1;
+                },
+                &found, &fac))
+    {
+      if (! Decompose (found, &part, &partScale)) return 0;
+      partScale *= fac;
+    }
+    if (! part.Power (e, &part) || ! result.Buildup ('*', part, &result))
+    {
+      return 0;
+    }
+    s *= pow (partScale, e);
+  }
+  *canon = result;
+  *scale = s;
+  return 1;
+}
+
+
+// Breadth-first search of the graph from start, for the nearest node
+// isGoal accepts (other than start itself), multiplying up the factors
+// along the way.  one start is *fac *found's.  (caller locks)
+template <class Matcher> int Conversion::Search (const Dimension & start,
+                                                 Matcher isGoal,
+                                                 Dimension * found,
+                                                 double * fac)
+{
+  struct Node
+  {
+    Dimension  d;
+    double     fac;
+  };
+  deque <Node>         queue;
+  vector <Dimension>   seen;
+  Node                 n;
+
+  n.d = start;
+  n.fac = 1;
+  queue.push_back (n);
+  seen.push_back (start);
+  while (! queue.empty())
+  {
+    vector <Edge>::iterator  it;
+
+    n = queue.front();
+    queue.pop_front();
+    for (it = edges.begin(); it != edges.end(); it++)
+    {
+      Node                          next;
+      vector <Dimension>::iterator  s;
+
+      if (it->from == n.d)
+      {
+        next.d = it->to;
+        next.fac = n.fac * it->factor;
+      }
+      else if (it->to == n.d)
+      {
+        next.d = it->from;
+        next.fac = n.fac / it->factor;
+      }
+      else continue;
+      for (s = seen.begin(); s != seen.end() && *s != next.d; s++) { }
+      if (s != seen.end()) continue;
+      if (isGoal (next.d))
+      {
+        *found = next.d;
+        *fac = next.fac;
+        return 1;
+      }
+      seen.push_back (next.d);
+      queue.push_back (next);
+    }
+  }
+  return 0;
+}
+
+
+// END OF FILE
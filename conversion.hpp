@@ -0,0 +1,105 @@
+/*
+conversion.hpp (Copyright 2003 David J. Aronson)
+Converting Measures between Units of the same kind (feet and meters, say),
+using conversion factors registered once.
+See also conversion.cpp, measure.*
+*/
+
+#ifndef CONVERSION_H
+#define CONVERSION_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "dimension.hpp"
+#include "measure.hpp"
+#include "measurearray.hpp"
+#include "unit.hpp"
+
+using namespace std;
+
+
+// how many recent conversions each thread remembers; see Convert
+#define CONVERSIONCACHESIZE 8
+
+
+// The known factors make a graph: each Unit makeup is a node, and each
+// AddFactor is an edge, usable either way.  To get from one Unit to
+// another, we look for a path of edges (so meter -> foot -> mile works
+// with no meter -> mile factor), and failing that, break both Units down
+// into base units and convert those one at a time (so m/s -> feet per
+// second works from just the meter -> foot factor).  Either way the
+// whole path comes down to one multiplier, which is all a Conversion
+// keeps, so applying it is a single multiply.
+//
+// Nodes are Dimensions rather than Unit pointers, so the graph doesn't
+// care if a temp Unit goes away (see Unit::ReclaimTemps).
+class Conversion
+{
+public:
+  // Constructors
+  Conversion (Unit * f, Unit * t);
+  // Member methods
+  double        GetFactor (void) { return factor; }
+  Unit *        GetFrom (void) { return from; }
+  Unit *        GetTo (void) { return to; }
+  double        Apply (double q) { return q * factor; }
+  Measure       Apply (Measure m);
+  MeasureArray  Apply (MeasureArray & a);
+  // Static methods
+  static void     AddFactor (Unit * f, Unit * t, double factor);
+  static void     AddFactor (Unit * f, Unit * t, Measure factor);
+  static Measure  Convert (Measure m, Unit * target);
+  static double   FindFactor (Unit * f, Unit * t);
+  // Exception classes
+  class NoPathError
+  {
+  public:
+    Unit *  from;
+    Unit *  to;
+    NoPathError (Unit * f, Unit * t)
+    {
+      from = f;
+      to = t;
+    }
+  };
+protected:
+  struct Edge
+  {
+    Dimension  from;
+    Dimension  to;
+    double     factor;   // one "from" is this many "to"
+  };
+  struct CacheEntry
+  {
+    Dimension  from;
+    Dimension  to;
+    ulong      epoch;    // 0 if unused
+    double     factor;
+  };
+  // Member data
+  Unit *    from;
+  Unit *    to;
+  double    factor;
+  // Member methods
+  Unit *    CheckFrom (Unit * u);
+  // Static data
+  static mutex            graphLock;
+  static vector <Edge>    edges;
+  static atomic <ulong>   graphEpoch;   // bumped by AddFactor
+  // Static methods
+  static int  Plan (const Dimension & f, const Dimension & t, double * fac);
+  static int  Decompose (const Dimension & d, Dimension * canon,
+                         double * scale);
+  template <class Matcher> static int  Search (const Dimension & start,
+                                               Matcher isGoal,
+                                               Dimension * found,
+                                               double * fac);
+};
+
+
+#endif // ifndef CONVERSION_H
+
+
+// END OF FILE
@@ -1,18 +1,18 @@
 #include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include "conversion.hpp"
 #include "measure.hpp"
+#include "measurearray.hpp"
 #include "measuredefs.hpp"
+#include "quantitystream.hpp"
 #include "unit.hpp"
 #include "unitdefs.hpp"
 
 
-double Convert
-(
-  double   qty,
-  Unit *   uIn,
-  Unit *   uOut,
-  char     op,
-  Measure  cvtFactor
-);
+int ChooseUnits (int argc, char * argv[], Unit ** uIn, Unit ** uOut);
+void ConvertStream (FILE * in, Conversion & cvt);
+void CantConvert (Unit * uIn, Unit * uOut);
 void GiveUsage();
 
 
@@ -20,42 +20,45 @@ int main (int argc, char * argv[])
 {
   double   dIn;
   double   dOut;
-  Measure  factor;
-  char     op;
   Unit *   uIn;
   Unit *   uOut;
+  int      used;
 
-  if (argc != 3) GiveUsage();
+  if (argc >= 3 && strcmp (argv[1], "-s") == 0)
+  {
+    FILE *  in = stdin;
+
+    used = ChooseUnits (argc - 2, argv + 2, &uIn, &uOut);
+    if (argc > used + 3) GiveUsage();
+    if (argc == used + 3 && (in = fopen (argv[used + 2], "rb")) == NULL)
+    {
+      perror (argv[used + 2]);
+      exit (1);
+    }
+    try
+    {
+      Conversion  cvt (uIn, uOut);
+      ConvertStream (in, cvt);
+    }
+    catch (Conversion::NoPathError)
+    {
+      CantConvert (uIn, uOut);
+    }
+    exit (0);
+  }
+
+  if (argc < 3) GiveUsage();
   dIn = atof (argv[1]);
-  switch (argv[2][0])
+  used = ChooseUnits (argc - 2, argv + 2, &uIn, &uOut);
+  if (argc != used + 2) GiveUsage();
+  try
+  {
+    dOut = Conversion::Convert (Measure (dIn, uIn), uOut).GetQuantity();
+  }
+  catch (Conversion::NoPathError)
   {
-    case 'f': case 'F':
-      factor = CONVERT_FEETPERMETER;
-      op = '/';
-      uIn = &FOOT;
-      uOut = &METER;
-    break;
-    case 'k': case 'K':
-      factor = CONVERT_SLUGSPERKILOGRAM;
-      op = '*';
-      uIn = &KILOGRAM;
-      uOut = &SLUG;
-    break;
-    case 'm': case 'M':
-      factor = CONVERT_FEETPERMETER;
-      op = '*';
-      uIn = &METER;
-      uOut = &FOOT;
-    break;
-    case 's': case 'S':
-      factor = CONVERT_SLUGSPERKILOGRAM;
-      op = '/';
-      uIn = &SLUG;
-      uOut = &KILOGRAM;
-    break;
-    default: GiveUsage(); break;
+    CantConvert (uIn, uOut);
   }
-  dOut = Convert (dIn, uIn, uOut, op, factor);
 
   cout << dIn << ' ' << uIn->GetName() << " = ";
   cout << dOut << ' ' << uOut->GetName() << endl;
@@ -64,23 +67,70 @@ int main (int argc, char * argv[])
 }
 
 
-double Convert
-(
-  double   qty,
-  Unit *   uIn,
-  Unit *   uOut,
-  char     op,
-  Measure  cvtFactor
-)
+// Work out the units from the command line: either one of the old
+// letters (f, k, m, s), or the names of two units (e.g. "m/s" "fps").
+// Returns how many args that took.
+int ChooseUnits (int argc, char * argv[], Unit ** uIn, Unit ** uOut)
 {
-  Measure  mIn = Measure (qty, uIn);
-  Measure  mOut = Measure (uOut);
+  if (argc >= 1 && strlen (argv[0]) == 1)
+  {
+    switch (argv[0][0])
+    {
+      case 'f': case 'F':
+        *uIn = &FOOT;
+        *uOut = &METER;
+      break;
+      case 'k': case 'K':
+        *uIn = &KILOGRAM;
+        *uOut = &SLUG;
+      break;
+      case 'm': case 'M':
+        *uIn = &METER;
+        *uOut = &FOOT;
+      break;
+      case 's': case 'S':
+        *uIn = &SLUG;
+        *uOut = &KILOGRAM;
+      break;
+      default: GiveUsage(); break;
+    }
+    return 1;
+  }
+  if (argc < 2) GiveUsage();
+  *uIn = Unit::FindUnitByName (argv[0]);
+  *uOut = Unit::FindUnitByName (argv[1]);
+  if (*uIn == NULL || *uOut == NULL)
+  {
+    cerr << "cvtunits: no such unit: " << argv[(*uIn == NULL) ? 0 : 1]
+         << endl;
+    exit (1);
+  }
+  return 2;
+}
 
-  if (op == '*') mOut = mIn * cvtFactor;
-  else if (op == '/') mOut = mIn / cvtFactor;
-  else throw Unit::BadOperatorError (op);
 
-  return mOut.GetQuantity();
+// Convert every quantity in a file, one result per line.  The
+// Conversion has already worked out the factor; it's applied a chunk at
+// a time.
+void ConvertStream (FILE * in, Conversion & cvt)
+{
+  string  bad;
+
+  if (! StreamQuantities (in, stdout, cvt.GetFrom(),
+                          [&cvt] (MeasureArray & a) { return cvt.Apply (a); },
+                          1, &bad))
+  {
+    cerr << "cvtunits: bad number: " << bad << endl;
+    exit (1);
+  }
+}
+
+
+void CantConvert (Unit * uIn, Unit * uOut)
+{
+  cerr << "cvtunits: can't convert " << uIn->GetName() << " to "
+       << uOut->GetName() << endl;
+  exit (1);
 }
 
 
@@ -88,9 +138,15 @@ void GiveUsage()
 {
   cout << "convert: convert between feet/meters or kilos/slugs" << endl;
   cout << "Usage: convert quantity unit" << endl;
+  cout << "   or: convert quantity from-unit to-unit" << endl;
+  cout << "   or: convert -s unit [file]" << endl;
+  cout << "   or: convert -s from-unit to-unit [file]" << endl;
   cout << "where convert is a number, and unit is f, m, k, or s" << endl;
+  cout << "(from-unit and to-unit are unit names, e.g. meter foot)" << endl;
   cout << "(slug is the Imperial unit of mass, upon which" << endl;
   cout << "Earth's surface gravity exerts a force of one pound.)" << endl;
+  cout << "With -s, converts every number in the file (or standard" << endl;
+  cout << "input), one result per line." << endl;
   exit (1);
 }
 
@@ -0,0 +1,173 @@
+/*
+dimension.hpp (Copyright 2003 David J. Aronson)
+Packed vector of base-unit exponents, which is what a Unit really is.
+See also unit.*
+*/
+
+
+#ifndef DIMENSION_H
+#define DIMENSION_H
+
+#include <bit>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+
+// how many base units there can be.  each one takes a byte in every
+// Dimension (and so in every Unit); 16 makes a Dimension exactly one
+// SSE register, so comparing two is one instruction.
+#ifndef MAXBASEUNITS
+#define MAXBASEUNITS 16
+#endif
+
+// biggest exponent (either sign) that any base unit may have
+#define MAXEXPONENT 127
+
+
+// E.g., for base units second, kilogram, meter (in that order),
+// a newton is { -2, 1, 1, 0, 0, ... }.  Multiplying or dividing units
+// adds or subtracts these, powers and roots scale them.  The methods
+// that could go out of range return zero if they would, and leave
+// *result alone; it's up to Unit to throw something about it.
+class Dimension
+{
+public:
+  // Constructors
+  constexpr Dimension (void) : exps() { }
+  // Member methods
+  constexpr int     GetExponent (int slot) const { return exps[slot]; }
+  constexpr size_t  Hash (void) const;
+  int               IsUnitless (void) const { return *this == Dimension(); }
+  constexpr int     Buildup (char op, const Dimension & d,
+                             Dimension * result) const;
+  constexpr int     Power (int pow, Dimension * result) const;
+  constexpr int     Root (int pow, Dimension * result) const;
+  int               operator == (const Dimension & d) const
+                    { return memcmp (exps, d.exps, sizeof (exps)) == 0; }
+  int               operator != (const Dimension & d) const
+                    { return ! (*this == d); }
+  // Static methods
+  static constexpr Dimension  Base (int slot);
+protected:
+  // Member data
+  signed char  exps[MAXBASEUNITS];
+};
+
+
+// multiply (op '*') or divide (op '/') by another dimension
+constexpr int Dimension::Buildup (char op, const Dimension & d,
+                                  Dimension * result) const
+{
+  int        bad = 0;
+  int        i;
+  Dimension  tmp;
+  int        sign = (op == '*') ? 1 : -1;
+
+  // no early exit, so the compiler can do all the slots at once
+  for (i = 0; i < MAXBASEUNITS; i++)
+  {
+    int  e = exps[i] + sign * d.exps[i];
+    bad |= (e > MAXEXPONENT) | (e < -MAXEXPONENT);
+    tmp.exps[i] = (signed char) e;
+  }
+  if (bad) return 0;
+  *result = tmp;
+  return 1;
+}
+
+
+// spread the bytes over a size_t, for the registry's hash index.
+// the compiler can do it too, for prebuilt indexes (see UnitIndex): it
+// puts the bytes into words by shifting, which gives what memcpy does
+// on a little-endian machine, and is what the rest use.
+constexpr size_t Dimension::Hash (void) const
+{
+  unsigned long long  h = 0;
+  unsigned long long  w = 0;
+  size_t              i = 0;
+  size_t              j = 0;
+
+  for (i = 0; i < sizeof (exps); i += sizeof (w))
+  {
+    w = 0;
+    if (std::is_constant_evaluated() ||
+        std::endian::native != std::endian::little)
+    {
+      for (j = 0; j < sizeof (w) && i + j < sizeof (exps); j++)
+      {
+        w |= (unsigned long long) (unsigned char) exps[i + j] << (8 * j);
+      }
+    }
+    else
+    {
+      memcpy (&w, exps + i, (sizeof (exps) - i < sizeof (w)) ?
+                            sizeof (exps) - i : sizeof (w));
+    }
+    h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+  }
+  return (size_t) h;
+}
+
+
+// raise to a power, e.g., (m/s).Power (3) = m^3 / s^3
+constexpr int Dimension::Power (int pow, Dimension * result) const
+{
+  int        bad = 0;
+  int        i;
+  Dimension  tmp;
+
+  if (pow > MAXEXPONENT || pow < -MAXEXPONENT)
+  {
+    // only unitless survives that (and stays unitless)
+    if (! IsUnitless()) return 0;
+    *result = *this;
+    return 1;
+  }
+  for (i = 0; i < MAXBASEUNITS; i++)
+  {
+    int  e = exps[i] * pow;
+    bad |= (e > MAXEXPONENT) | (e < -MAXEXPONENT);
+    tmp.exps[i] = (signed char) e;
+  }
+  if (bad) return 0;
+  *result = tmp;
+  return 1;
+}
+
+
+// take the pow'th root -- which only works if every exponent divides
+// evenly, e.g., (m^3 / s^3).Root (3) = m/s, but (m^3).Root (2) is no good
+constexpr int Dimension::Root (int pow, Dimension * result) const
+{
+  int        bad = 0;
+  int        i;
+  Dimension  tmp;
+
+  if (pow == 0) return 0;
+  for (i = 0; i < MAXBASEUNITS; i++)
+  {
+    bad |= (exps[i] % pow != 0);
+    tmp.exps[i] = (signed char) (exps[i] / pow);
+  }
+  if (bad) return 0;
+  *result = tmp;
+  return 1;
+}
+
+
+// the dimension of the base unit in a given slot
+constexpr Dimension Dimension::Base (int slot)
+{
+  Dimension  d;
+
+  d.exps[slot] = 1;
+  return d;
+}
+
+
+#endif // ifndef DIMENSION_H
+
+
+// END OF FILE
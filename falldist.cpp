@@ -1,19 +1,26 @@
 #include <iostream>
+#include <stdio.h>
+#include <string.h>
 #include "measure.hpp"
 #include "measuredefs.hpp"
+#include "measureexpr.hpp"
+#include "quantitystream.hpp"
+#include "trajectory.hpp"
 #include "unit.hpp"
 #include "unitdefs.hpp"
 
 void ParseArgs (int argc, char * argv[], Measure * time);
+void DoBatch (int argc, char * argv[]);
 
 int main (int argc, char * argv[])
 {
   Measure height = Measure (&METER);
   Measure time = Measure (&SECOND);
 
+  if (argc >= 2 && strcmp (argv[1], "-s") == 0) DoBatch (argc, argv);
   ParseArgs (argc, argv, &time);
 
-  height = G * 0.5 * time.power (2);  // d = 1/2 a t^2
+  height = Lazy (G) * 0.5 * Lazy (time).power <2> ();  // d = 1/2 a t^2
   cout << "At " << G.GetQuantity();
   cout << " meters per second per second," << endl << "an object will fall ";
   cout << height.GetQuantity() << " meters in ";
@@ -27,11 +34,37 @@ void GiveUsage()
   cout << "falldist: tell how far an object will fall at 9.8 m/s/s" << endl;
   cout << "          in a given number of seconds (ignoring air resistance)." << endl;
   cout << "Usage: falldist time" << endl;
+  cout << "   or: falldist -s [file]" << endl;
   cout << "where time is a non-negative number, in seconds" << endl;
+  cout << "With -s, does every time in the file (or standard input)," << endl;
+  cout << "one answer per line." << endl;
   exit (1);
 }
 
 
+// with -s: every time in a file (or standard input), one answer per line
+void DoBatch (int argc, char * argv[])
+{
+  FILE *  in = stdin;
+  string  bad;
+
+  if (argc > 3) GiveUsage();
+  if (argc == 3 && (in = fopen (argv[2], "rb")) == NULL)
+  {
+    perror (argv[2]);
+    exit (1);
+  }
+  if (! StreamQuantities (in, stdout, &SECOND,
+                          [] (MeasureArray & a) { return FallDistances (a, G); },
+                          0, &bad))
+  {
+    cerr << "falldist: bad time: " << bad << endl;
+    exit (1);
+  }
+  exit (0);
+}
+
+
 void ParseArgs (int argc, char * argv[], Measure * time)
 {
   double d;
@@ -1,16 +1,22 @@
 #include <iostream>
+#include <stdio.h>
+#include <string.h>
 #include "measure.hpp"
 #include "measuredefs.hpp"
+#include "quantitystream.hpp"
+#include "trajectory.hpp"
 #include "unit.hpp"
 #include "unitdefs.hpp"
 
 void ParseArgs (int argc, char * argv[], Measure * time);
+void DoBatch (int argc, char * argv[]);
 
 int main (int argc, char * argv[])
 {
   Measure height = Measure (&METER);
   Measure time = Measure (&SECOND);
 
+  if (argc >= 2 && strcmp (argv[1], "-s") == 0) DoBatch (argc, argv);
   ParseArgs (argc, argv, &height);
 
   time = (height * 2.0 / G).root (2);  // t = sqrt (2d/a)
@@ -27,11 +33,37 @@ void GiveUsage()
   cout << "falltime: tell how long an object will take to fall a given" << endl;
   cout << "          height at 9.8 m/s/s (ignoring air resistance)." << endl;
   cout << "Usage: falltime height" << endl;
+  cout << "   or: falltime -s [file]" << endl;
   cout << "where height is a non-negative number, in meters" << endl;
+  cout << "With -s, does every height in the file (or standard input)," << endl;
+  cout << "one answer per line." << endl;
   exit (1);
 }
 
 
+// with -s: every height in a file (or standard input), one answer per line
+void DoBatch (int argc, char * argv[])
+{
+  FILE *  in = stdin;
+  string  bad;
+
+  if (argc > 3) GiveUsage();
+  if (argc == 3 && (in = fopen (argv[2], "rb")) == NULL)
+  {
+    perror (argv[2]);
+    exit (1);
+  }
+  if (! StreamQuantities (in, stdout, &METER,
+                          [] (MeasureArray & a) { return FallTimes (a, G); },
+                          0, &bad))
+  {
+    cerr << "falltime: bad height: " << bad << endl;
+    exit (1);
+  }
+  exit (0);
+}
+
+
 void ParseArgs (int argc, char * argv[], Measure * height)
 {
   double d;
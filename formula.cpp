@@ -0,0 +1,491 @@
+/*
+formula.cpp (Copyright 2003 David J. Aronson)
+Formulas given as text, like "sqrt (2*d/G)", with their Units checked once
+when compiled, then evaluated over plain doubles.
+See also formula.hpp, measure.*
+*/
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "formula.hpp"
+#include "simd.hpp"
+#include "unit.hpp"
+
+
+// x to the (whole) p, by repeated squaring, as Measure::power does it
+static double PowerOf (double x, int p)
+{
+  double    r = 1;
+  unsigned  q = (p > 0) ? p : -(unsigned) p;
+
+  for (; q != 0; q >>= 1)
+  {
+    if (q & 1) r *= x;
+    x *= x;
+  }
+  return (p < 0) ? 1.0 / r : r;
+}
+
+
+// PUBLIC STUFF
+
+
+// Constructors
+
+
+Formula::Formula (string t)
+{
+  text = t;
+  pos = 0;
+  depth = 0;
+  maxDepth = 0;
+  compiled = 0;
+  unit = NULL;
+}
+
+
+// Member methods
+
+
+// a name whose value (and Unit) is fixed, like G.  it's folded into the
+// code at Compile time, so changing it means compiling again.
+void Formula::BindConstant (string name, Measure m)
+{
+  constNames.push_back (name);
+  constValues.push_back (m);
+  compiled = 0;
+}
+
+
+// a name whose value is given at each Evaluate, in Unit u.  returns
+// where its value goes in the arrays Evaluate takes (i.e., the order
+// the variables were bound in).
+int Formula::BindVariable (string name, Unit * u)
+{
+  varNames.push_back (name);
+  varUnits.push_back (u);
+  compiled = 0;
+  return varNames.size() - 1;
+}
+
+
+// parse the text, check the Units, and make the code.  throws ParseError
+// if the text is no good, or Unit's errors if the Units don't work out
+// (e.g., Unit::MismatchError for adding meters to seconds).
+void Formula::Compile (void)
+{
+  Operand  result;
+
+  code.clear();
+  depth = 0;
+  maxDepth = 0;
+  compiled = 0;
+  pos = 0;
+  result = ParseSum();
+  SkipSpaces();
+  if (pos < text.size()) Fail ("expected an operator");
+  Materialize (&result);
+  unit = result.unit;
+  compiled = 1;
+}
+
+
+// evaluate on plain numbers, one per variable, in the variables' Units
+double Formula::Evaluate (const double * vars)
+{
+  double                          stack[FORMULAMAXDEPTH];
+  int                             d = 0;
+  vector <Instruction>::iterator  it;
+
+  if (! compiled) throw NotCompiledError();
+  for (it = code.begin(); it != code.end(); it++)
+  {
+    switch (it->op)
+    {
+      case PUSHK:   stack[d++] = it->arg; break;
+      case PUSHVAR: stack[d++] = vars[it->n]; break;
+      case ADD:     d--; stack[d - 1] += stack[d]; break;
+      case SUB:     d--; stack[d - 1] -= stack[d]; break;
+      case MUL:     d--; stack[d - 1] *= stack[d]; break;
+      case DIV:     d--; stack[d - 1] /= stack[d]; break;
+      case ADDK:    stack[d - 1] += it->arg; break;
+      case SUBK:    stack[d - 1] -= it->arg; break;
+      case MULK:    stack[d - 1] *= it->arg; break;
+      case DIVK:    stack[d - 1] /= it->arg; break;
+      case KDIV:    stack[d - 1] = it->arg / stack[d - 1]; break;
+      case NEG:     stack[d - 1] = -stack[d - 1]; break;
+      case POWER:   stack[d - 1] = PowerOf (stack[d - 1], it->n); break;
+      case SQRT:    stack[d - 1] = sqrt (stack[d - 1]); break;
+      case CBRT:    stack[d - 1] = cbrt (stack[d - 1]); break;
+    }
+  }
+  return stack[0];
+}
+
+
+// evaluate on Measures, one per variable, whose Units are checked
+Measure Formula::Evaluate (Measure * vars)
+{
+  double           few[16];     // enough, most of the time
+  vector <double>  many;
+  double *         q = few;
+  size_t           i;
+
+  if (! compiled) throw NotCompiledError();
+  if (varUnits.size() > 16)
+  {
+    many.resize (varUnits.size());
+    q = many.data();
+  }
+  for (i = 0; i < varUnits.size(); i++)
+  {
+    if (*vars[i].GetUnit() != *varUnits[i])
+    {
+      throw Unit::MismatchError (vars[i].GetUnit(), varUnits[i]);
+    }
+    q[i] = vars[i].GetQuantity();
+  }
+  return Measure (Evaluate (q), unit);
+}
+
+
+// Evaluate element by element over arrays, one per variable, all the
+// same size.  The Units are checked once for the whole arrays, and each
+// instruction is done FORMULABLOCKSIZE elements at a time, with the
+// vector kernels.  The results are the same as the one-at-a-time ones.
+MeasureArray Formula::Evaluate (MeasureArray * vars)
+{
+  size_t        n = varUnits.empty() ? 1 : vars[0].GetSize();
+  MeasureArray  result;
+  double *      stack;
+  size_t        start;
+  size_t        i;
+
+  if (! compiled) throw NotCompiledError();
+  for (i = 0; i < varUnits.size(); i++)
+  {
+    if (*vars[i].GetUnit() != *varUnits[i])
+    {
+      throw Unit::MismatchError (vars[i].GetUnit(), varUnits[i]);
+    }
+    if (vars[i].GetSize() != n)
+    {
+      throw MeasureArray::SizeMismatchError (n, vars[i].GetSize());
+    }
+  }
+  result = MeasureArray (unit, n);
+  // one more block than the stack needs, for KDIV to fill with its k
+  stack = (double *) aligned_alloc (ALIGNMENT, (maxDepth + 1) *
+                                    FORMULABLOCKSIZE * sizeof (double));
+  if (stack == NULL) throw bad_alloc();
+  for (start = 0; start < n; start += FORMULABLOCKSIZE)
+  {
+    size_t                          len = n - start;
+    double *                        top = stack;   // first free block
+    vector <Instruction>::iterator  it;
+
+    if (len > FORMULABLOCKSIZE) len = FORMULABLOCKSIZE;
+    for (it = code.begin(); it != code.end(); it++)
+    {
+      double *  x = top - FORMULABLOCKSIZE;        // top of stack
+      double *  y = x - FORMULABLOCKSIZE;          // just under it
+
+      switch (it->op)
+      {
+        case PUSHK:
+          for (i = 0; i < len; i++) top[i] = it->arg;
+          top += FORMULABLOCKSIZE;
+        break;
+        case PUSHVAR:
+          memcpy (top, vars[it->n].GetQuantities() + start,
+                  len * sizeof (double));
+          top += FORMULABLOCKSIZE;
+        break;
+        case ADD:  SimdAdd (y, x, y, len); top = x; break;
+        case SUB:  SimdSub (y, x, y, len); top = x; break;
+        case MUL:  SimdMul (y, x, y, len); top = x; break;
+        case DIV:  SimdDiv (y, x, y, len); top = x; break;
+        case ADDK: SimdAddScalar (x, it->arg, x, len); break;
+        case SUBK: SimdSubScalar (x, it->arg, x, len); break;
+        case MULK: SimdMulScalar (x, it->arg, x, len); break;
+        case DIVK: SimdDivScalar (x, it->arg, x, len); break;
+        case KDIV:
+          for (i = 0; i < len; i++) top[i] = it->arg;
+          SimdDiv (top, x, x, len);
+        break;
+        case NEG:   SimdMulScalar (x, -1.0, x, len); break;
+        case POWER: SimdPower (x, it->n, x, len); break;
+        case SQRT:  SimdRoot (x, 2, x, len); break;
+        case CBRT:  SimdRoot (x, 3, x, len); break;
+      }
+    }
+    memcpy (result.GetQuantities() + start, stack, len * sizeof (double));
+  }
+  free (stack);
+  return result;
+}
+
+
+// PROTECTED STUFF
+
+
+// Member methods -- the parser, one method per precedence level.  Each
+// returns what it parsed as an Operand: constants aren't put in the code
+// until something needs them there, so they can be folded together.
+
+
+// a + b - c ...
+Formula::Operand Formula::ParseSum (void)
+{
+  Operand  a = ParseProduct();
+
+  for (SkipSpaces(); pos < text.size() && strchr ("+-", text[pos]);
+       SkipSpaces())
+  {
+    char  c = text[pos++];
+    a = Binary (c, a, ParseProduct());
+  }
+  return a;
+}
+
+
+// a * b / c ...
+Formula::Operand Formula::ParseProduct (void)
+{
+  Operand  a = ParseUnary();
+
+  for (SkipSpaces(); pos < text.size() && strchr ("*/", text[pos]);
+       SkipSpaces())
+  {
+    char  c = text[pos++];
+    a = Binary (c, a, ParseUnary());
+  }
+  return a;
+}
+
+
+// -a
+Formula::Operand Formula::ParseUnary (void)
+{
+  Operand  a;
+
+  SkipSpaces();
+  if (pos < text.size() && text[pos] == '-')
+  {
+    pos++;
+    a = ParseUnary();
+    if (a.isConstant) a.value = -a.value;
+    else Emit (NEG, 0, 0);
+    return a;
+  }
+  if (pos < text.size() && text[pos] == '+')
+  {
+    pos++;
+    return ParseUnary();
+  }
+  return ParsePower();
+}
+
+
+// a^n, where n is a whole number (so the Unit can be worked out)
+Formula::Operand Formula::ParsePower (void)
+{
+  Operand  a = ParsePrimary();
+  long     n;
+  char *   end;
+
+  SkipSpaces();
+  if (pos >= text.size() || text[pos] != '^') return a;
+  pos++;
+  SkipSpaces();
+  errno = 0;
+  n = strtol (text.c_str() + pos, &end, 10);
+  if (end == text.c_str() + pos) Fail ("expected a whole-number power");
+  // (before n is made an int anywhere below, so it can't wrap around)
+  if (errno == ERANGE || n > MAXEXPONENT || n < -MAXEXPONENT)
+  {
+    Fail ("power too big");
+  }
+  pos = end - text.c_str();
+  a.unit = a.unit->power (n);
+  if (a.isConstant) a.value = PowerOf (a.value, n);
+  else Emit (POWER, 0, n);
+  return a;
+}
+
+
+// a number, a name, a function, or something in parentheses
+Formula::Operand Formula::ParsePrimary (void)
+{
+  Operand  a;
+  string   name;
+  size_t   i;
+
+  SkipSpaces();
+  if (pos >= text.size()) Fail ("unexpected end");
+  a.isConstant = 1;
+  a.value = 0;
+  a.unit = &Unit::UNITLESS;
+  if (text[pos] == '(')
+  {
+    pos++;
+    a = ParseSum();
+    SkipSpaces();
+    if (pos >= text.size() || text[pos] != ')') Fail ("expected )");
+    pos++;
+    return a;
+  }
+  if (isdigit (text[pos]) || text[pos] == '.')
+  {
+    char *  end;
+
+    a.value = strtod (text.c_str() + pos, &end);
+    pos = end - text.c_str();
+    return a;
+  }
+  name = ParseName();
+  SkipSpaces();
+  if ((name == "sqrt" || name == "cbrt") && pos < text.size() &&
+      text[pos] == '(')
+  {
+    int  r = (name == "sqrt") ? 2 : 3;
+
+    a = ParsePrimary();
+    a.unit = a.unit->root (r);
+    if (a.isConstant) a.value = (r == 2) ? sqrt (a.value) : cbrt (a.value);
+    else Emit ((r == 2) ? SQRT : CBRT, 0, 0);
+    return a;
+  }
+  for (i = 0; i < constNames.size(); i++)
+  {
+    if (constNames[i] == name)
+    {
+      a.value = constValues[i].GetQuantity();
+      a.unit = constValues[i].GetUnit();
+      return a;
+    }
+  }
+  for (i = 0; i < varNames.size(); i++)
+  {
+    if (varNames[i] == name)
+    {
+      a.isConstant = 0;
+      a.unit = varUnits[i];
+      Emit (PUSHVAR, 0, i);
+      return a;
+    }
+  }
+  pos -= name.size();
+  Fail ("unknown name " + name);
+  return a;
+}
+
+
+// a c b, for c one of + - * /.  the Units are worked out (or checked)
+// here, once.  (b's code, if any, has already been emitted after a's.)
+Formula::Operand Formula::Binary (char c, Operand a, Operand b)
+{
+  Operand  r;
+
+  if (c == '+' || c == '-')
+  {
+    if (*a.unit != *b.unit) throw Unit::MismatchError (a.unit, b.unit);
+    r.unit = a.unit;
+  }
+  else r.unit = Unit::FindUnitByBuildup (a.unit, c, b.unit);
+  r.isConstant = a.isConstant && b.isConstant;
+  r.value = 0;
+  if (r.isConstant)
+  {
+    if (c == '+') r.value = a.value + b.value;
+    else if (c == '-') r.value = a.value - b.value;
+    else if (c == '*') r.value = a.value * b.value;
+    else r.value = a.value / b.value;
+  }
+  else if (b.isConstant)
+  {
+    Emit ((c == '+') ? ADDK : (c == '-') ? SUBK : (c == '*') ? MULK : DIVK,
+          b.value, 0);
+  }
+  else if (a.isConstant)
+  {
+    // b is on the stack, but a isn't
+    if (c == '+') Emit (ADDK, a.value, 0);
+    else if (c == '*') Emit (MULK, a.value, 0);
+    else if (c == '/') Emit (KDIV, a.value, 0);
+    else
+    {
+      // a - b is exactly -b + a
+      Emit (NEG, 0, 0);
+      Emit (ADDK, a.value, 0);
+    }
+  }
+  else Emit ((c == '+') ? ADD : (c == '-') ? SUB : (c == '*') ? MUL : DIV,
+             0, 0);
+  return r;
+}
+
+
+// add an instruction to the code, keeping track of how deep the stack
+// will get
+void Formula::Emit (OpCode op, double arg, int n)
+{
+  Instruction  i;
+
+  if (op == PUSHK || op == PUSHVAR) depth++;
+  else if (op == ADD || op == SUB || op == MUL || op == DIV) depth--;
+  if (depth > FORMULAMAXDEPTH) Fail ("formula nested too deeply");
+  if (depth > maxDepth) maxDepth = depth;
+  i.op = op;
+  i.arg = arg;
+  i.n = n;
+  code.push_back (i);
+}
+
+
+// make sure a (say, a whole formula that came out constant) is in the code
+void Formula::Materialize (Operand * a)
+{
+  if (a->isConstant)
+  {
+    Emit (PUSHK, a->value, 0);
+    a->isConstant = 0;
+  }
+}
+
+
+void Formula::SkipSpaces (void)
+{
+  while (pos < text.size() && isspace (text[pos])) pos++;
+}
+
+
+// a name: a letter or underscore, then letters, digits, or underscores
+string Formula::ParseName (void)
+{
+  size_t  start = pos;
+
+  if (pos >= text.size() || ! (isalpha (text[pos]) || text[pos] == '_'))
+  {
+    Fail ("expected a number or a name");
+  }
+  while (pos < text.size() && (isalnum (text[pos]) || text[pos] == '_'))
+  {
+    pos++;
+  }
+  return text.substr (start, pos - start);
+}
+
+
+void Formula::Fail (string problem)
+{
+  throw ParseError (text, pos, problem);
+}
+
+
+// END OF FILE
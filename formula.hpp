@@ -0,0 +1,117 @@
+/*
+formula.hpp (Copyright 2003 David J. Aronson)
+Formulas given as text, like "sqrt (2*d/G)", with their Units checked once
+when compiled, then evaluated over plain doubles.
+See also formula.cpp, measure.*
+*/
+
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include <string>
+#include <vector>
+
+#include "measure.hpp"
+#include "measurearray.hpp"
+
+class Unit;
+
+using namespace std;
+
+
+// how many values the batch Evaluate works on per instruction
+#define FORMULABLOCKSIZE 256
+
+// how deep the evaluation stack may get (i.e., how nested a formula)
+#define FORMULAMAXDEPTH 32
+
+
+// A Formula is parsed and unit-checked once, by Compile, into a little
+// stack-machine program over doubles.  After that, evaluating it does no
+// unit work at all, except checking (once per call) that the variables
+// are in the Units they were bound to.
+//
+// Names in the formula are either constants, whose values (and Units)
+// are taken at Compile time, or variables, which are only given a Unit,
+// and supply their values at each Evaluate.  The grammar is the usual:
+//   + - (binary and unary)  * /  x^n (n a whole number)  ( )
+//   sqrt (x)  cbrt (x)  numbers (unitless)  names
+class Formula
+{
+public:
+  // Constructors
+  Formula (string t);
+  // Member methods
+  void          BindConstant (string name, Measure m);
+  int           BindVariable (string name, Unit * u);
+  void          Compile (void);
+  Unit *        GetUnit (void) { return unit; }
+  string        GetText (void) { return text; }
+  double        Evaluate (const double * vars);
+  Measure       Evaluate (Measure * vars);
+  MeasureArray  Evaluate (MeasureArray * vars);
+  // Exception classes
+  class ParseError
+  {
+  public:
+    string  text;
+    size_t  pos;      // where in text it went wrong
+    string  problem;
+    ParseError (string t, size_t p, string s)
+    {
+      text = t;
+      pos = p;
+      problem = s;
+    }
+  };
+  class NotCompiledError { };
+protected:
+  // the instructions.  the "K" ones take a constant (arg) as the right
+  // operand, rather than popping it (KDIV, as the left: arg / x).
+  enum OpCode { PUSHK, PUSHVAR, ADD, SUB, MUL, DIV, ADDK, SUBK, MULK, DIVK,
+                KDIV, NEG, POWER, SQRT, CBRT };
+  struct Instruction
+  {
+    OpCode  op;
+    double  arg;      // the constant, for PUSHK and the K ops
+    int     n;        // the variable, for PUSHVAR; the power, for POWER
+  };
+  // what Compile knows about a subexpression: its Unit, and whether
+  // it's a constant (and if so, what), so it can be folded
+  struct Operand
+  {
+    Unit *  unit;
+    int     isConstant;
+    double  value;
+  };
+  // Member data
+  string                 text;
+  size_t                 pos;          // where the parser is in text
+  vector <string>        constNames;
+  vector <Measure>       constValues;
+  vector <string>        varNames;
+  vector <Unit *>        varUnits;
+  vector <Instruction>   code;
+  int                    depth;        // how deep the stack is, so far
+  int                    maxDepth;     // deepest the stack gets
+  int                    compiled;
+  Unit *                 unit;         // of the result
+  // Member methods
+  Operand  ParseSum (void);
+  Operand  ParseProduct (void);
+  Operand  ParseUnary (void);
+  Operand  ParsePower (void);
+  Operand  ParsePrimary (void);
+  Operand  Binary (char c, Operand a, Operand b);
+  void     Emit (OpCode op, double arg, int n);
+  void     Materialize (Operand * a);
+  void     SkipSpaces (void);
+  string   ParseName (void);
+  void     Fail (string problem);
+};
+
+
+#endif // ifndef FORMULA_H
+
+
+// END OF FILE
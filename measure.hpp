@@ -6,50 +6,482 @@ System for avoiding improper mixing of units of measure
 #ifndef MEASURE_H
 #define MEASURE_H
 
-class Unit;
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
 
-class Measure;
+#include "unit.hpp"
+#include "unitstats.hpp"
 
-class Measure
+
+// what the Try methods say went wrong, if anything
+enum MeasureStatus
+{
+  MEASURE_OK = 0,
+  MEASURE_MISMATCH,     // Units don't match (Unit::MismatchError)
+  MEASURE_BADROOT,      // not a whole root (Unit::BadRootError)
+  MEASURE_OVERFLOW      // exponent too big (Unit::OverflowError)
+};
+
+template <class T> class BasicMeasure;
+
+// The hot operations are here, inline, so a loop over Measures compiles
+// down to the arithmetic plus a compare of Unit ids.  Arguments are
+// const references, and the compound operators (+= etc.) work in place,
+// checking the Units once, rather than making a new Measure and then
+// assigning it.
+//
+// A Measure keeps its Unit's id (see UnitId), not a pointer to it, so
+// checking Units never has to look at the Units themselves: Units of the
+// same dimension have the same id.  GetUnit looks the Unit up again, and
+// so gives the one the id stands for, which may not be the very one the
+// Measure was made with.  (Since the id is taken when the Measure is
+// made, a static Measure of a Unit that isn't one of the built-in ones
+// has to be made after that Unit is.)
+//
+// T is the type of the quantity.  Measure (double) is the usual one;
+// FloatMeasure is half the size, and its arithmetic stays in float, so
+// loops over lots of them do twice as many per vector instruction.
+// Changing from one T to another is never implicit: use the converting
+// constructor, as in FloatMeasure (m).
+template <class T>
+class BasicMeasure
 {
 public:
   // Constructors
-  Measure (void);
-  Measure (Unit * u);
-  Measure (double q, Unit * u);
+  // (for when we don't even know what unit the Measure will be in.
+  // Note that ONLY such a Measure can change its unit!)
+  constexpr BasicMeasure (void) noexcept : quantity (0), id (0) { }
+  // (a Measure of this unit, when we don't know the quantity yet)
+  constexpr BasicMeasure (Unit * u) noexcept : quantity (0), id (IdOf (u))
+            { }
+  constexpr BasicMeasure (T q, Unit * u) noexcept
+            : quantity (q), id (IdOf (u)) { }
+  constexpr BasicMeasure (const BasicMeasure & m) = default;
+  // (the same Measure, with the quantity rounded or widened to T)
+  template <class U>
+  constexpr explicit BasicMeasure (const BasicMeasure <U> & m) noexcept
+    : quantity ((T) m.GetQuantity()), id (m.GetUnitId()) { }
   // Member methods
-  double   GetQuantity() { return quantity; }
-  Unit *   GetUnit() { return unit; }
-  Measure  power (int pow);
-  Measure  root (int pow);
-  Measure  operator + (Measure m);
-  Measure  operator - (Measure m);
-  Measure  operator * (Measure m);
-  Measure  operator / (Measure m);
-  void     operator += (Measure m) { *this = *this + m; }
-  void     operator -= (Measure m) { *this = *this - m; }
-  void     operator *= (Measure m) { *this = *this * m; }
-  void     operator /= (Measure m) { *this = *this / m; }
-  void     operator *= (double d) { *this = *this * d; }
-  void     operator /= (double d) { *this = *this / d; }
-  Measure  operator * (double d) { return Measure (quantity * d, unit); }
-  Measure  operator / (double d) { return Measure (quantity / d, unit); }
+  constexpr T       GetQuantity (void) const noexcept { return quantity; }
+  Unit *            GetUnit (void) const noexcept
+                    { return Unit::FromId (id); }
+  constexpr UnitId  GetUnitId (void) const noexcept { return id; }
+  BasicMeasure  power (int pow) const;
+  BasicMeasure  root (int pow) const;
+  BasicMeasure  sqrt (void) const;
+  BasicMeasure  cbrt (void) const;
+  BasicMeasure  operator + (const BasicMeasure & m) const
+                {
+                  STATS_COUNT (STATS_ADDS);
+                  CheckUnits (id, m.id);
+                  return WithId (quantity + m.quantity, id);
+                }
+  BasicMeasure  operator - (const BasicMeasure & m) const
+                {
+                  STATS_COUNT (STATS_SUBS);
+                  CheckUnits (id, m.id);
+                  return WithId (quantity - m.quantity, id);
+                }
+  BasicMeasure  operator * (const BasicMeasure & m) const
+                {
+                  STATS_COUNT (STATS_MULS);
+                  return WithId (quantity * m.quantity,
+                                 Unit::FindIdByBuildup (id, '*', m.id));
+                }
+  BasicMeasure  operator / (const BasicMeasure & m) const
+                {
+                  STATS_COUNT (STATS_DIVS);
+                  return WithId (quantity / m.quantity,
+                                 Unit::FindIdByBuildup (id, '/', m.id));
+                }
+  BasicMeasure  operator * (T d) const
+                {
+                  STATS_COUNT (STATS_MULS);
+                  return WithId (quantity * d, id);
+                }
+  BasicMeasure  operator / (T d) const
+                {
+                  STATS_COUNT (STATS_DIVS);
+                  return WithId (quantity / d, id);
+                }
+  BasicMeasure &  operator += (const BasicMeasure & m)
+                  {
+                    STATS_COUNT (STATS_ADDS);
+                    CheckUnits (id, m.id);
+                    quantity += m.quantity;
+                    return *this;
+                  }
+  BasicMeasure &  operator -= (const BasicMeasure & m)
+                  {
+                    STATS_COUNT (STATS_SUBS);
+                    CheckUnits (id, m.id);
+                    quantity -= m.quantity;
+                    return *this;
+                  }
+  // (the product's Unit has to be the one this already has, so m must
+  // be unitless)
+  BasicMeasure &  operator *= (const BasicMeasure & m)
+                  {
+                    STATS_COUNT (STATS_MULS);
+                    CheckUnits (id, Unit::FindIdByBuildup (id, '*', m.id));
+                    quantity *= m.quantity;
+                    return *this;
+                  }
+  BasicMeasure &  operator /= (const BasicMeasure & m)
+                  {
+                    STATS_COUNT (STATS_DIVS);
+                    CheckUnits (id, Unit::FindIdByBuildup (id, '/', m.id));
+                    quantity /= m.quantity;
+                    return *this;
+                  }
+  BasicMeasure &  operator *= (T d) noexcept
+                  {
+                    STATS_COUNT (STATS_MULS);
+                    quantity *= d;
+                    return *this;
+                  }
+  BasicMeasure &  operator /= (T d) noexcept
+                  {
+                    STATS_COUNT (STATS_DIVS);
+                    quantity /= d;
+                    return *this;
+                  }
   // overloading of + and - to add numbers purposely OMITTED!
   // same for autoincrement/autodecrement
-  Measure  operator = (Measure m);
-  int      operator == (Measure m);
-  int      operator < (Measure m);
-  int      operator > (Measure m);
-  int      operator <= (Measure m);
-  int      operator >= (Measure m);
+  BasicMeasure &  operator = (const BasicMeasure & m)  // ASSIGNMENT
+                  {
+                    STATS_COUNT (STATS_ASSIGNS);
+                    if (id == 0) id = m.id;
+                    else CheckUnits (id, m.id);
+                    quantity = m.quantity;
+                    return *this;
+                  }
+  int      operator == (const BasicMeasure & m) const
+           {
+             STATS_COUNT (STATS_COMPARES);
+             CheckUnits (id, m.id);
+             return quantity == m.quantity;
+           }
+  int      operator < (const BasicMeasure & m) const
+           {
+             STATS_COUNT (STATS_COMPARES);
+             CheckUnits (id, m.id);
+             return quantity < m.quantity;
+           }
+  int      operator > (const BasicMeasure & m) const
+           {
+             STATS_COUNT (STATS_COMPARES);
+             CheckUnits (id, m.id);
+             return quantity > m.quantity;
+           }
+  int      operator <= (const BasicMeasure & m) const
+           {
+             STATS_COUNT (STATS_COMPARES);
+             CheckUnits (id, m.id);
+             return quantity <= m.quantity;
+           }
+  int      operator >= (const BasicMeasure & m) const
+           {
+             STATS_COUNT (STATS_COMPARES);
+             CheckUnits (id, m.id);
+             return quantity >= m.quantity;
+           }
+  MeasureStatus  TryAdd (const BasicMeasure & m, BasicMeasure * result) const;
+  MeasureStatus  TrySub (const BasicMeasure & m, BasicMeasure * result) const;
+  MeasureStatus  TryMul (const BasicMeasure & m, BasicMeasure * result) const;
+  MeasureStatus  TryDiv (const BasicMeasure & m, BasicMeasure * result) const;
+  MeasureStatus  TryPower (int pow, BasicMeasure * result) const;
+  MeasureStatus  TryRoot (int pow, BasicMeasure * result) const;
+  MeasureStatus  TryAssign (const BasicMeasure & m);
+  // Static methods
+  // (a Measure from a Unit's id, as from GetUnitId)
+  static constexpr BasicMeasure  WithId (T q, UnitId u) noexcept
+                                 {
+                                   BasicMeasure  m;
+
+                                   m.quantity = q;
+                                   m.id = u;
+                                   return m;
+                                 }
+  static size_t  Validate (const BasicMeasure * m, size_t n, Unit * u,
+                           uint64_t * bad);
 protected:
   // Member data
-  double  quantity;
-  Unit *  unit;
-  // Member methods
-  void    CheckUnits (Unit * u1, Unit * u2);
+  T       quantity;
+  UnitId  id;       // (0 for no Unit yet)
+  // Static methods
+  static constexpr UnitId  IdOf (Unit * u) noexcept
+                           { return (u != NULL) ? u->GetId() : 0; }
+  // make sure the units are compatible: the same dimension is the same
+  // id, so that's all there is to it
+  static void    CheckUnits (UnitId u1, UnitId u2)
+                 {
+                   STATS_COUNT (STATS_CHECKUNITS);
+                   if (u1 != u2) ThrowMismatch (u1, u2);
+                 }
+  // what roots and reciprocals are worked out in: T, unless it's a whole
+  // number type, whose are worked out in double and rounded back
+  typedef conditional_t <is_integral <T>::value, double, T>  Real;
+  [[noreturn]] static void  ThrowMismatch (UnitId u1, UnitId u2);
+  static T       PowerQuantity (T x, int power);
+  static T       RootQuantity (T x, int power);
+  static T       FromReal (Real r)
+                 {
+                   if constexpr (is_integral <T>::value) return llround (r);
+                   else return r;
+                 }
 };
 
+typedef BasicMeasure <double>       Measure;
+typedef BasicMeasure <float>        FloatMeasure;
+typedef BasicMeasure <long double>  LongMeasure;
+
+
+// The rest of BasicMeasure.  It's all here, so a Measure of any T works;
+// for the three above, it's made once, in measure.cpp, rather than in
+// every file that uses it.
+
+
+// Member methods
+
+
+// raise a measure to a power, like c in e=mc^2.
+// the Unit is done first, so a power too big for it throws before we
+// bother with the quantity, which is done by repeated squaring.
+template <class T>
+BasicMeasure <T> BasicMeasure <T>::power (int power) const
+{
+  Unit *  u;
+
+  STATS_COUNT (STATS_POWERS);
+  if (power == 0) return BasicMeasure (1, &Unit::UNITLESS);
+  if (power == 1) return *this;
+  u = GetUnit()->power (power);
+  return BasicMeasure (PowerQuantity (quantity, power), u);
+}
+
+
+// take the nth root of a measure, like da in t = sqrt (2da)
+// (time it takes something to go distance "d" under acceleration "a")
+// square and cube roots, by far the usual ones, skip pow().
+template <class T>
+BasicMeasure <T> BasicMeasure <T>::root (int power) const
+{
+  Unit *  u;
+
+  STATS_COUNT (STATS_ROOTS);
+  if (power == 1) return *this;
+  u = GetUnit()->root (power);
+  return BasicMeasure (RootQuantity (quantity, power), u);
+}
+
+
+template <class T>
+BasicMeasure <T> BasicMeasure <T>::sqrt (void) const
+{
+  STATS_COUNT (STATS_ROOTS);
+  return BasicMeasure (RootQuantity (quantity, 2), GetUnit()->root (2));
+}
+
+
+template <class T>
+BasicMeasure <T> BasicMeasure <T>::cbrt (void) const
+{
+  STATS_COUNT (STATS_ROOTS);
+  return BasicMeasure (RootQuantity (quantity, 3), GetUnit()->root (3));
+}
+
+
+// The non-throwing versions, for when bad input is to be expected and
+// exceptions would cost too much.  Each returns MEASURE_OK and sets
+// *result (which is replaced, not assigned to, so its Unit needn't
+// match), or returns what's wrong and leaves *result alone.
+
+
+template <class T>
+MeasureStatus BasicMeasure <T>::TryAdd (const BasicMeasure & m,
+                                        BasicMeasure * result) const
+{
+  STATS_COUNT (STATS_ADDS);
+  if (id != m.id) return MEASURE_MISMATCH;
+  result->quantity = quantity + m.quantity;
+  result->id = id;
+  return MEASURE_OK;
+}
+
+
+template <class T>
+MeasureStatus BasicMeasure <T>::TrySub (const BasicMeasure & m,
+                                        BasicMeasure * result) const
+{
+  STATS_COUNT (STATS_SUBS);
+  if (id != m.id) return MEASURE_MISMATCH;
+  result->quantity = quantity - m.quantity;
+  result->id = id;
+  return MEASURE_OK;
+}
+
+
+template <class T>
+MeasureStatus BasicMeasure <T>::TryMul (const BasicMeasure & m,
+                                        BasicMeasure * result) const
+{
+  Unit *  u = Unit::TryBuildup (GetUnit(), '*', m.GetUnit());
+
+  STATS_COUNT (STATS_MULS);
+  if (u == NULL) return MEASURE_OVERFLOW;
+  result->quantity = quantity * m.quantity;
+  result->id = u->GetId();
+  return MEASURE_OK;
+}
+
+
+template <class T>
+MeasureStatus BasicMeasure <T>::TryDiv (const BasicMeasure & m,
+                                        BasicMeasure * result) const
+{
+  Unit *  u = Unit::TryBuildup (GetUnit(), '/', m.GetUnit());
+
+  STATS_COUNT (STATS_DIVS);
+  if (u == NULL) return MEASURE_OVERFLOW;
+  result->quantity = quantity / m.quantity;
+  result->id = u->GetId();
+  return MEASURE_OK;
+}
+
+
+template <class T>
+MeasureStatus BasicMeasure <T>::TryPower (int power,
+                                          BasicMeasure * result) const
+{
+  Unit *  u = GetUnit()->TryPower (power);
+
+  STATS_COUNT (STATS_POWERS);
+  if (u == NULL) return MEASURE_OVERFLOW;
+  result->quantity = (power == 0) ? 1 : PowerQuantity (quantity, power);
+  result->id = u->GetId();
+  return MEASURE_OK;
+}
+
+
+template <class T>
+MeasureStatus BasicMeasure <T>::TryRoot (int power,
+                                         BasicMeasure * result) const
+{
+  Unit *  u = GetUnit()->TryRoot (power);
+
+  STATS_COUNT (STATS_ROOTS);
+  if (u == NULL) return MEASURE_BADROOT;
+  result->quantity = (power == 1) ? quantity : RootQuantity (quantity, power);
+  result->id = u->GetId();
+  return MEASURE_OK;
+}
+
+
+// assignment, as with =, but without throwing
+template <class T>
+MeasureStatus BasicMeasure <T>::TryAssign (const BasicMeasure & m)
+{
+  STATS_COUNT (STATS_ASSIGNS);
+  if (id != 0 && id != m.id) return MEASURE_MISMATCH;
+  if (id == 0) id = m.id;
+  quantity = m.quantity;
+  return MEASURE_OK;
+}
+
+
+// Static methods
+
+
+// Check n Measures against Unit u: bit i of bad (bad[i / 64], bit
+// i % 64) is set if m[i] isn't in u, and cleared if it is.  bad must have
+// room for (n + 63) / 64 words.  Returns how many weren't in u.
+template <class T>
+size_t BasicMeasure <T>::Validate (const BasicMeasure * m, size_t n,
+                                  Unit * u, uint64_t * bad)
+{
+  UnitId    want = u->GetId();
+  size_t    count = 0;
+  size_t    i;
+  uint64_t  word = 0;
+
+  for (i = 0; i < n; i++)
+  {
+    // (a Measure with no Unit yet has id 0, so is never right)
+    uint64_t  b = (m[i].id != want);
+
+    word |= b << (i % 64);
+    count += b;
+    if (i % 64 == 63)
+    {
+      bad[i / 64] = word;
+      word = 0;
+    }
+  }
+  if (n % 64 != 0) bad[n / 64] = word;
+  return count;
+}
+
+
+// Protected static methods
+
+
+// the rest of CheckUnits, for different Units (kept out of line, so the
+// inline part stays small)
+template <class T>
+void BasicMeasure <T>::ThrowMismatch (UnitId u1, UnitId u2)
+{
+  throw Unit::MismatchError (Unit::FromId (u1), Unit::FromId (u2));
+}
+
+
+// x to a whole power (not 0), by repeated squaring
+template <class T>
+T BasicMeasure <T>::PowerQuantity (T x, int power)
+{
+  T         d = 1;
+  unsigned  p = (power > 0) ? power : -(unsigned) power;
+
+  for (; p != 0; p >>= 1)
+  {
+    if (p & 1) d *= x;
+    x *= x;
+  }
+  return (power < 0) ? FromReal ((Real) 1 / d) : d;
+}
+
+
+// x's root.  square and cube roots, by far the usual ones, skip pow().
+template <class T>
+T BasicMeasure <T>::RootQuantity (T x, int power)
+{
+  Real  y = x;
+  Real  d;
+
+  if (power == 2 || power == -2) d = ::sqrt (y);
+  else if (power == 3 || power == -3) d = ::cbrt (y);
+  else return FromReal (pow (y, (Real) 1 / power));
+  return FromReal ((power < 0) ? (Real) 1 / d : d);
+}
+
+
+// (made in measure.cpp)
+extern template class BasicMeasure <double>;
+extern template class BasicMeasure <float>;
+extern template class BasicMeasure <long double>;
+
+// A Measure can't be trivially copyable, since = checks the Units, but
+// copying one (and so passing one by value) is just copying a struct.
+static_assert (is_trivially_copy_constructible <Measure>::value &&
+               is_trivially_destructible <Measure>::value,
+               "Measure should copy like a plain struct");
+// (a quantity and an id, padded out to keep the quantities aligned in
+// arrays: so a FloatMeasure is half a Measure)
+static_assert (sizeof (Measure) <= 16, "Measure should be 16 bytes at most");
+static_assert (sizeof (FloatMeasure) == 8, "FloatMeasure should be 8 bytes");
+
 #endif // ifndef MEASURE_H
 
 
@@ -0,0 +1,297 @@
+/*
+measurearray.cpp (Copyright 2003 David J. Aronson)
+Arrays of quantities that all share one Unit, for bulk number-crunching.
+See also measure.*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "measurearray.hpp"
+#include "simd.hpp"
+#include "unit.hpp"
+
+
+// PUBLIC STUFF
+
+
+// Constructors
+
+
+// an empty array, of no Unit yet -- like Measure (void), it takes on
+// the Unit of whatever is first assigned to it
+MeasureArray::MeasureArray (void)
+{
+  unit = NULL;
+  quantity = NULL;
+  size = 0;
+}
+
+
+// n quantities of a given unit, all zero
+MeasureArray::MeasureArray (Unit * u, size_t n)
+{
+  unit = u;
+  Allocate (n);
+  memset (quantity, 0, n * sizeof (double));
+}
+
+
+// n quantities of a given unit, left for the caller to fill in
+MeasureArray::MeasureArray (Unit * u, size_t n, NoInit)
+{
+  unit = u;
+  Allocate (n);
+}
+
+
+// n quantities of a given unit, copied from q
+MeasureArray::MeasureArray (Unit * u, const double * q, size_t n)
+{
+  unit = u;
+  Allocate (n);
+  memcpy (quantity, q, n * sizeof (double));
+}
+
+
+MeasureArray::MeasureArray (const MeasureArray & a)
+{
+  unit = a.unit;
+  Allocate (a.size);
+  memcpy (quantity, a.quantity, size * sizeof (double));
+}
+
+
+// take over a temporary's quantities, rather than copying them
+MeasureArray::MeasureArray (MeasureArray && a)
+{
+  unit = a.unit;
+  quantity = a.quantity;
+  size = a.size;
+  a.quantity = NULL;
+  a.size = 0;
+}
+
+
+// Destructor
+
+
+MeasureArray::~MeasureArray (void)
+{
+  free (quantity);
+}
+
+
+// Member methods
+
+
+// set one element, which must be in the array's unit
+void MeasureArray::Set (size_t i, Measure m)
+{
+  CheckUnits (unit, m.GetUnit());
+  quantity[i] = m.GetQuantity();
+}
+
+
+// raise every element to a power (the unit, just once)
+MeasureArray MeasureArray::power (int pow)
+{
+  MeasureArray  result (unit->power (pow), size, NOINIT);
+
+  SimdPower (quantity, pow, result.quantity, size);
+  return result;
+}
+
+
+// take the pow'th root of every element (the unit, just once)
+MeasureArray MeasureArray::root (int pow)
+{
+  MeasureArray  result (unit->root (pow), size, NOINIT);
+
+  SimdRoot (quantity, pow, result.quantity, size);
+  return result;
+}
+
+
+// (the sizes and Units are checked before the result gets any room)
+MeasureArray MeasureArray::operator + (const MeasureArray & a)
+{
+  MeasureArray  result (CheckUnits (unit, a.unit), CheckSizes (a), NOINIT);
+
+  SimdAdd (quantity, a.quantity, result.quantity, size);
+  return result;
+}
+
+
+MeasureArray MeasureArray::operator - (const MeasureArray & a)
+{
+  MeasureArray  result (CheckUnits (unit, a.unit), CheckSizes (a), NOINIT);
+
+  SimdSub (quantity, a.quantity, result.quantity, size);
+  return result;
+}
+
+
+MeasureArray MeasureArray::operator * (const MeasureArray & a)
+{
+  MeasureArray  result (Unit::FindUnitByBuildup (unit, '*', a.unit),
+                        CheckSizes (a), NOINIT);
+
+  SimdMul (quantity, a.quantity, result.quantity, size);
+  return result;
+}
+
+
+MeasureArray MeasureArray::operator / (const MeasureArray & a)
+{
+  MeasureArray  result (Unit::FindUnitByBuildup (unit, '/', a.unit),
+                        CheckSizes (a), NOINIT);
+
+  SimdDiv (quantity, a.quantity, result.quantity, size);
+  return result;
+}
+
+
+// every element times the same Measure
+MeasureArray MeasureArray::operator * (Measure m)
+{
+  MeasureArray  result (Unit::FindUnitByBuildup (unit, '*', m.GetUnit()),
+                        size, NOINIT);
+
+  SimdMulScalar (quantity, m.GetQuantity(), result.quantity, size);
+  return result;
+}
+
+
+// every element divided by the same Measure
+MeasureArray MeasureArray::operator / (Measure m)
+{
+  MeasureArray  result (Unit::FindUnitByBuildup (unit, '/', m.GetUnit()),
+                        size, NOINIT);
+
+  SimdDivScalar (quantity, m.GetQuantity(), result.quantity, size);
+  return result;
+}
+
+
+MeasureArray MeasureArray::operator * (double d)
+{
+  MeasureArray  result (unit, size, NOINIT);
+
+  SimdMulScalar (quantity, d, result.quantity, size);
+  return result;
+}
+
+
+MeasureArray MeasureArray::operator / (double d)
+{
+  MeasureArray  result (unit, size, NOINIT);
+
+  SimdDivScalar (quantity, d, result.quantity, size);
+  return result;
+}
+
+
+// the in-place ones don't need a result array at all
+void MeasureArray::operator += (const MeasureArray & a)
+{
+  CheckSizes (a);
+  CheckUnits (unit, a.unit);
+  SimdAdd (quantity, a.quantity, quantity, size);
+}
+
+
+void MeasureArray::operator -= (const MeasureArray & a)
+{
+  CheckSizes (a);
+  CheckUnits (unit, a.unit);
+  SimdSub (quantity, a.quantity, quantity, size);
+}
+
+
+void MeasureArray::operator *= (double d)
+{
+  SimdMulScalar (quantity, d, quantity, size);
+}
+
+
+void MeasureArray::operator /= (double d)
+{
+  SimdDivScalar (quantity, d, quantity, size);
+}
+
+
+// ASSIGNMENT -- as with Measure, the unit must match, unless this
+// array has none yet.  The size follows the source.
+MeasureArray & MeasureArray::operator = (const MeasureArray & a)
+{
+  if (this == &a) return *this;
+  if (unit == NULL) unit = a.unit;
+  else CheckUnits (unit, a.unit);
+  if (size != a.size)
+  {
+    // (empty, not dangling, if there's no room for the new size)
+    free (quantity);
+    quantity = NULL;
+    size = 0;
+    Allocate (a.size);
+  }
+  memcpy (quantity, a.quantity, size * sizeof (double));
+  return *this;
+}
+
+
+// ASSIGNMENT from a temporary -- same rules, but takes over its buffer
+MeasureArray & MeasureArray::operator = (MeasureArray && a)
+{
+  if (this == &a) return *this;
+  if (unit == NULL) unit = a.unit;
+  else CheckUnits (unit, a.unit);
+  free (quantity);
+  quantity = a.quantity;
+  size = a.size;
+  a.quantity = NULL;
+  a.size = 0;
+  return *this;
+}
+
+
+// PROTECTED STUFF
+
+
+// Member methods
+
+
+// get (uninitialized) aligned room for n quantities
+void MeasureArray::Allocate (size_t n)
+{
+  size_t  bytes = n * sizeof (double);
+
+  // aligned_alloc wants a multiple of the alignment (and at least one)
+  bytes = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  if (bytes == 0) bytes = ALIGNMENT;
+  quantity = (double *) aligned_alloc (ALIGNMENT, bytes);
+  if (quantity == NULL) throw bad_alloc();
+  size = n;
+}
+
+
+// (the size, so a result can be made from it once it's checked)
+size_t MeasureArray::CheckSizes (const MeasureArray & a)
+{
+  if (size != a.size) throw SizeMismatchError (size, a.size);
+  return size;
+}
+
+
+// make sure the units are compatible, as Measure does (and give back
+// the one to make a result in)
+Unit * MeasureArray::CheckUnits (Unit * u1, Unit * u2)
+{
+  if (*u1 != *u2) throw Unit::MismatchError (u1, u2);
+  return u1;
+}
+
+
+// END OF FILE
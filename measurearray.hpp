@@ -0,0 +1,85 @@
+/*
+measurearray.hpp (Copyright 2003 David J. Aronson)
+Arrays of quantities that all share one Unit, for bulk number-crunching.
+See also measure.*
+*/
+
+#ifndef MEASUREARRAY_H
+#define MEASUREARRAY_H
+
+#include <stddef.h>
+
+#include "measure.hpp"
+
+class Unit;
+
+
+// A MeasureArray is like a bunch of Measures in the same Unit, but the
+// Unit is kept only once, and the quantities are kept together (aligned
+// for SIMD).  Operators check (or work out) the Unit ONCE for the whole
+// array, then crunch the quantities with vector instructions where the
+// CPU has them.
+class MeasureArray
+{
+public:
+  // Constructors
+  MeasureArray (void);
+  MeasureArray (Unit * u, size_t n);
+  // (n quantities NOT set to anything, for a result about to be filled
+  // in completely, so it isn't written twice)
+  enum NoInit { NOINIT };
+  MeasureArray (Unit * u, size_t n, NoInit);
+  MeasureArray (Unit * u, const double * q, size_t n);
+  MeasureArray (const MeasureArray & a);
+  MeasureArray (MeasureArray && a);
+  // Destructor
+  ~MeasureArray (void);
+  // Member methods
+  size_t        GetSize (void) { return size; }
+  Unit *        GetUnit (void) { return unit; }
+  double *      GetQuantities (void) { return quantity; }
+  Measure       Get (size_t i) { return Measure (quantity[i], unit); }
+  void          Set (size_t i, Measure m);
+  MeasureArray  power (int pow);
+  MeasureArray  root (int pow);
+  MeasureArray  operator + (const MeasureArray & a);
+  MeasureArray  operator - (const MeasureArray & a);
+  MeasureArray  operator * (const MeasureArray & a);
+  MeasureArray  operator / (const MeasureArray & a);
+  MeasureArray  operator * (Measure m);
+  MeasureArray  operator / (Measure m);
+  MeasureArray  operator * (double d);
+  MeasureArray  operator / (double d);
+  void          operator += (const MeasureArray & a);
+  void          operator -= (const MeasureArray & a);
+  void          operator *= (double d);
+  void          operator /= (double d);
+  MeasureArray &  operator = (const MeasureArray & a);
+  MeasureArray &  operator = (MeasureArray && a);
+  // Exception classes
+  class SizeMismatchError
+  {
+  public:
+    size_t  size1, size2;
+    SizeMismatchError (size_t a, size_t b)
+    {
+      size1 = a;
+      size2 = b;
+    }
+  };
+protected:
+  // Member data
+  Unit *    unit;
+  double *  quantity;   // aligned to ALIGNMENT bytes
+  size_t    size;
+  // Member methods
+  void      Allocate (size_t n);
+  size_t    CheckSizes (const MeasureArray & a);
+  Unit *    CheckUnits (Unit * u1, Unit * u2);
+};
+
+
+#endif // ifndef MEASUREARRAY_H
+
+
+// END OF FILE
@@ -0,0 +1,461 @@
+/*
+measureexpr.hpp (Copyright 2003 David J. Aronson)
+Lazy expressions of Measures and MeasureArrays, worked out in one pass.
+See also measure.*, measurearray.*
+*/
+
+#ifndef MEASUREEXPR_H
+#define MEASUREEXPR_H
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+#include "measure.hpp"
+#include "measurearray.hpp"
+#include "unit.hpp"
+
+
+// Lazy (m) (or Lazy (a), for a MeasureArray) starts an expression that
+// isn't worked out as it's written.  + - * / (with Measures, arrays,
+// other expressions, or numbers), power <P> () and root <R> () just
+// build up a little tree, in its type, with nothing done yet.  When it
+// becomes a Measure (or, if any of it is an array, a MeasureArray) --
+// by assigning it to one, say -- the result's Unit is worked out once,
+// and then the quantities, in one pass, with no Measures or arrays in
+// between.  So
+//
+//   height = Lazy (G) * 0.5 * Lazy (time).power <2> ();
+//   MeasureArray  d = Lazy (G) * 0.5 * Lazy (times).power <2> ();
+//
+// do what the plain operators do (and throw what they throw), but the
+// second makes one array, in one loop, rather than three.
+//
+// The Unit is only worked out from scratch the first time: each shape
+// of expression remembers (per thread) its last operands' Unit ids and
+// the result's, so long as no Unit has gone away since.  After that,
+// it's comparing a few ids.
+//
+// An expression refers to its arrays, rather than copying them, so it's
+// only good till the end of the statement it's in: don't keep one (in an
+// auto variable, say).
+
+
+template <class E, int P> class PowerExpr;
+template <class E, int R> class RootExpr;
+
+
+// what all the expressions have in common (E is the expression itself)
+template <class E>
+class MeasureExpr
+{
+public:
+  // Member methods
+  const E &  Self (void) const { return static_cast <const E &> (*this); }
+  UnitId     ResolveId (void) const;
+  operator   Measure (void) const;
+  operator   MeasureArray (void) const;
+  template <int P> PowerExpr <E, P>  power (void) const;
+  template <int R> RootExpr <E, R>   root (void) const;
+};
+
+
+// a Measure
+class LeafExpr : public MeasureExpr <LeafExpr>
+{
+public:
+  static constexpr int  LEAVES = 1;
+  static constexpr int  ARRAY = 0;
+  // Constructors
+  LeafExpr (const Measure & m) : quantity (m.GetQuantity()),
+                                 id (m.GetUnitId()) { }
+  // Member methods
+  double  At (size_t i) const { (void) i; return quantity; }
+  size_t  Size (void) const { return 0; }
+  UnitId  Id (void) const { return id; }
+  void    GetIds (UnitId * ids) const { ids[0] = id; }
+protected:
+  // Member data
+  double  quantity;
+  UnitId  id;
+};
+
+
+// a MeasureArray
+class ArrayLeafExpr : public MeasureExpr <ArrayLeafExpr>
+{
+public:
+  static constexpr int  LEAVES = 1;
+  static constexpr int  ARRAY = 1;
+  // Constructors
+  ArrayLeafExpr (MeasureArray & a)
+    : quantity (a.GetQuantities()), size (a.GetSize()),
+      id ((a.GetUnit() != NULL) ? a.GetUnit()->GetId() : 0) { }
+  // Member methods
+  double  At (size_t i) const { return quantity[i]; }
+  size_t  Size (void) const { return size; }
+  UnitId  Id (void) const { return id; }
+  void    GetIds (UnitId * ids) const { ids[0] = id; }
+protected:
+  // Member data
+  const double *  quantity;
+  size_t          size;
+  UnitId          id;
+};
+
+
+// l OP r, for OP + - * or /
+template <class L, class R, char OP>
+class BinaryExpr : public MeasureExpr <BinaryExpr <L, R, OP> >
+{
+public:
+  static constexpr int  LEAVES = L::LEAVES + R::LEAVES;
+  static constexpr int  ARRAY = L::ARRAY || R::ARRAY;
+  // Constructors
+  BinaryExpr (const L & a, const R & b) : l (a), r (b) { }
+  // Member methods
+  double  At (size_t i) const
+          {
+            if (OP == '+') return l.At (i) + r.At (i);
+            if (OP == '-') return l.At (i) - r.At (i);
+            if (OP == '*') return l.At (i) * r.At (i);
+            return l.At (i) / r.At (i);
+          }
+  // (throws MeasureArray::SizeMismatchError if both sides are arrays,
+  // of different sizes)
+  size_t  Size (void) const
+          {
+            if constexpr (L::ARRAY && R::ARRAY)
+            {
+              if (l.Size() != r.Size())
+              {
+                throw MeasureArray::SizeMismatchError (l.Size(), r.Size());
+              }
+            }
+            return L::ARRAY ? l.Size() : r.Size();
+          }
+  // (throws just what the operators on Measures would)
+  UnitId  Id (void) const
+          {
+            UnitId  a = l.Id();
+            UnitId  b = r.Id();
+
+            if (OP == '*' || OP == '/') return Unit::FindIdByBuildup (a, OP, b);
+            if (a != b)
+            {
+              throw Unit::MismatchError (Unit::FromId (a), Unit::FromId (b));
+            }
+            return a;
+          }
+  void    GetIds (UnitId * ids) const
+          {
+            l.GetIds (ids);
+            r.GetIds (ids + L::LEAVES);
+          }
+protected:
+  // Member data
+  L  l;
+  R  r;
+};
+
+
+// e * d or e / d (OP '*' or '/'), for a number d.  (d * e is e * d.)
+template <class E, char OP>
+class ScaleExpr : public MeasureExpr <ScaleExpr <E, OP> >
+{
+public:
+  static constexpr int  LEAVES = E::LEAVES;
+  static constexpr int  ARRAY = E::ARRAY;
+  // Constructors
+  ScaleExpr (const E & x, double by) : e (x), d (by) { }
+  // Member methods
+  double  At (size_t i) const
+          { return (OP == '*') ? e.At (i) * d : e.At (i) / d; }
+  size_t  Size (void) const { return e.Size(); }
+  UnitId  Id (void) const { return e.Id(); }
+  void    GetIds (UnitId * ids) const { e.GetIds (ids); }
+protected:
+  // Member data
+  E       e;
+  double  d;
+};
+
+
+// e to the P'th power, P fixed when compiling (and not 0)
+template <class E, int P>
+class PowerExpr : public MeasureExpr <PowerExpr <E, P> >
+{
+public:
+  static constexpr int  LEAVES = E::LEAVES;
+  static constexpr int  ARRAY = E::ARRAY;
+  // Constructors
+  PowerExpr (const E & x) : e (x) { static_assert (P != 0, "power <0>"); }
+  // Member methods
+  double  At (size_t i) const
+          {
+            double  x = e.At (i);
+
+            return (P < 0) ? 1.0 / Raise <(P < 0) ? -P : P> (x)
+                           : Raise <(P < 0) ? -P : P> (x);
+          }
+  size_t  Size (void) const { return e.Size(); }
+  UnitId  Id (void) const
+          { return Unit::FromId (e.Id())->power (P)->GetId(); }
+  void    GetIds (UnitId * ids) const { e.GetIds (ids); }
+protected:
+  // Member data
+  E  e;
+  // Static methods
+  // x^N, by repeated squaring, unrolled (as Measure::power does it)
+  template <int N> static double  Raise (double x)
+                                  {
+                                    if constexpr (N == 1) return x;
+                                    else if constexpr (N % 2 == 0)
+                                    {
+                                      return Raise <N / 2> (x * x);
+                                    }
+                                    else return x * Raise <N / 2> (x * x);
+                                  }
+};
+
+
+// e's R'th root, R fixed when compiling (and not 0)
+template <class E, int R>
+class RootExpr : public MeasureExpr <RootExpr <E, R> >
+{
+public:
+  static constexpr int  LEAVES = E::LEAVES;
+  static constexpr int  ARRAY = E::ARRAY;
+  // Constructors
+  RootExpr (const E & x) : e (x) { static_assert (R != 0, "root <0>"); }
+  // Member methods
+  double  At (size_t i) const
+          {
+            double  x = e.At (i);
+
+            if constexpr (R == 1) return x;
+            else if constexpr (R == 2) return ::sqrt (x);
+            else if constexpr (R == 3) return ::cbrt (x);
+            else if constexpr (R == -2) return 1.0 / ::sqrt (x);
+            else if constexpr (R == -3) return 1.0 / ::cbrt (x);
+            else return pow (x, 1.0 / R);
+          }
+  size_t  Size (void) const { return e.Size(); }
+  UnitId  Id (void) const
+          { return Unit::FromId (e.Id())->root (R)->GetId(); }
+  void    GetIds (UnitId * ids) const { e.GetIds (ids); }
+protected:
+  // Member data
+  E  e;
+};
+
+
+// the Unit, worked out once for each new set of operands' Units (see
+// above).  seen is per thread, and per expression type.
+template <class E>
+UnitId MeasureExpr <E>::ResolveId (void) const
+{
+  struct Seen
+  {
+    ulong   epoch;            // 0 till something's in here
+    UnitId  leaves[E::LEAVES];
+    UnitId  result;
+  };
+  static thread_local Seen  seen;
+  UnitId                    ids[E::LEAVES];
+  ulong                     epoch = Unit::GetEpoch();
+
+  Self().GetIds (ids);
+  if (seen.epoch == epoch && memcmp (ids, seen.leaves, sizeof (ids)) == 0)
+  {
+    return seen.result;
+  }
+  seen.result = Self().Id();
+  memcpy (seen.leaves, ids, sizeof (ids));
+  seen.epoch = epoch;
+  return seen.result;
+}
+
+
+// work it all out, for an expression of just Measures
+template <class E>
+MeasureExpr <E>::operator Measure (void) const
+{
+  static_assert (! E::ARRAY, "an expression with arrays is a MeasureArray");
+  UnitId  id = ResolveId();
+
+  return Measure::WithId (Self().At (0), id);
+}
+
+
+// work it all out, for an expression with an array in it: the sizes and
+// the Unit first, then all the quantities, in one loop
+template <class E>
+MeasureExpr <E>::operator MeasureArray (void) const
+{
+  static_assert (E::ARRAY, "an expression of just Measures is a Measure");
+  size_t        n = Self().Size();
+  MeasureArray  result (Unit::FromId (ResolveId()), n, MeasureArray::NOINIT);
+  double *      out = result.GetQuantities();
+  size_t        i;
+
+  for (i = 0; i < n; i++) out[i] = Self().At (i);
+  return result;
+}
+
+
+template <class E>
+template <int P>
+PowerExpr <E, P> MeasureExpr <E>::power (void) const
+{
+  return PowerExpr <E, P> (Self());
+}
+
+
+template <class E>
+template <int R>
+RootExpr <E, R> MeasureExpr <E>::root (void) const
+{
+  return RootExpr <E, R> (Self());
+}
+
+
+// starting one off
+inline LeafExpr Lazy (const Measure & m)
+{
+  return LeafExpr (m);
+}
+
+
+inline ArrayLeafExpr Lazy (MeasureArray & a)
+{
+  return ArrayLeafExpr (a);
+}
+
+
+// the operators.  a plain Measure can go on either side of an
+// expression, and a number can multiply or divide one.
+
+
+template <class L, class R>
+BinaryExpr <L, R, '+'> operator + (const MeasureExpr <L> & l,
+                                   const MeasureExpr <R> & r)
+{
+  return BinaryExpr <L, R, '+'> (l.Self(), r.Self());
+}
+
+
+template <class L, class R>
+BinaryExpr <L, R, '-'> operator - (const MeasureExpr <L> & l,
+                                   const MeasureExpr <R> & r)
+{
+  return BinaryExpr <L, R, '-'> (l.Self(), r.Self());
+}
+
+
+template <class L, class R>
+BinaryExpr <L, R, '*'> operator * (const MeasureExpr <L> & l,
+                                   const MeasureExpr <R> & r)
+{
+  return BinaryExpr <L, R, '*'> (l.Self(), r.Self());
+}
+
+
+template <class L, class R>
+BinaryExpr <L, R, '/'> operator / (const MeasureExpr <L> & l,
+                                   const MeasureExpr <R> & r)
+{
+  return BinaryExpr <L, R, '/'> (l.Self(), r.Self());
+}
+
+
+template <class L>
+BinaryExpr <L, LeafExpr, '+'> operator + (const MeasureExpr <L> & l,
+                                          const Measure & m)
+{
+  return l + Lazy (m);
+}
+
+
+template <class L>
+BinaryExpr <L, LeafExpr, '-'> operator - (const MeasureExpr <L> & l,
+                                          const Measure & m)
+{
+  return l - Lazy (m);
+}
+
+
+template <class L>
+BinaryExpr <L, LeafExpr, '*'> operator * (const MeasureExpr <L> & l,
+                                          const Measure & m)
+{
+  return l * Lazy (m);
+}
+
+
+template <class L>
+BinaryExpr <L, LeafExpr, '/'> operator / (const MeasureExpr <L> & l,
+                                          const Measure & m)
+{
+  return l / Lazy (m);
+}
+
+
+template <class R>
+BinaryExpr <LeafExpr, R, '+'> operator + (const Measure & m,
+                                          const MeasureExpr <R> & r)
+{
+  return Lazy (m) + r;
+}
+
+
+template <class R>
+BinaryExpr <LeafExpr, R, '-'> operator - (const Measure & m,
+                                          const MeasureExpr <R> & r)
+{
+  return Lazy (m) - r;
+}
+
+
+template <class R>
+BinaryExpr <LeafExpr, R, '*'> operator * (const Measure & m,
+                                          const MeasureExpr <R> & r)
+{
+  return Lazy (m) * r;
+}
+
+
+template <class R>
+BinaryExpr <LeafExpr, R, '/'> operator / (const Measure & m,
+                                          const MeasureExpr <R> & r)
+{
+  return Lazy (m) / r;
+}
+
+
+template <class E>
+ScaleExpr <E, '*'> operator * (const MeasureExpr <E> & e, double d)
+{
+  return ScaleExpr <E, '*'> (e.Self(), d);
+}
+
+
+template <class E>
+ScaleExpr <E, '*'> operator * (double d, const MeasureExpr <E> & e)
+{
+  return ScaleExpr <E, '*'> (e.Self(), d);
+}
+
+
+template <class E>
+ScaleExpr <E, '/'> operator / (const MeasureExpr <E> & e, double d)
+{
+  return ScaleExpr <E, '/'> (e.Self(), d);
+}
+
+
+#endif // ifndef MEASUREEXPR_H
+
+
+// END OF FILE
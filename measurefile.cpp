@@ -0,0 +1,416 @@
+/*
+measurefile.cpp (Copyright 2003 David J. Aronson)
+Saving lots of Measures to a binary file, and mapping them back in without
+any parsing.
+See also measurefile.hpp, measurearray.*
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "measurefile.hpp"
+
+
+// how much a MeasureWriter's FILE buffers
+#define WRITEBUFSIZE (1 << 20)
+
+// no unit looked up yet; see MeasureWriter::GetId
+#define NOID 0xffffffff
+
+
+// PUBLIC STUFF
+
+
+// Constructors
+
+
+// start a new file (replacing any that's there)
+MeasureWriter::MeasureWriter (string p)
+{
+  FileHeader  h;
+
+  path = p;
+  file = fopen (p.c_str(), "wb");
+  if (file == NULL) throw IOError (p, errno);
+  setvbuf (file, NULL, _IOFBF, WRITEBUFSIZE);
+  offset = 0;
+  lastId = NOID;
+  baseWritten.resize (MAXBASEUNITS, 0);
+  pending.reserve (RECORDBLOCKSIZE);
+  memset (&h, 0, sizeof (h));
+  memcpy (h.magic, "MEASURES", sizeof (h.magic));
+  h.version = MEASUREFILEVERSION;
+  h.byteOrder = 0x01020304;
+  h.maxBaseUnits = MAXBASEUNITS;
+  h.alignment = ALIGNMENT;
+  WriteBytes (&h, sizeof (h));
+}
+
+
+// map in a file, and read its unit dictionary
+MeasureReader::MeasureReader (string p)
+{
+  int          fd;
+  struct stat  st;
+
+  path = p;
+  total = 0;
+  Rewind();
+  fd = open (p.c_str(), O_RDONLY);
+  if (fd < 0) throw IOError (p, errno);
+  if (fstat (fd, &st) != 0)
+  {
+    int  e = errno;
+    close (fd);
+    throw IOError (p, e);
+  }
+  mapSize = st.st_size;
+  if (mapSize < sizeof (FileHeader))
+  {
+    close (fd);
+    throw FormatError (p, "too short to be a measure file");
+  }
+  map = (char *) mmap (NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED) throw IOError (p, errno);
+  try { Scan(); }
+  catch (...)
+  {
+    munmap (map, mapSize);
+    throw;
+  }
+}
+
+
+// Destructor
+
+
+// (if writing the rest fails here, there's no one left to tell; call
+// Close first to find out)
+MeasureWriter::~MeasureWriter (void)
+{
+  try { Close(); }
+  catch (IOError) { }
+}
+
+
+MeasureReader::~MeasureReader (void)
+{
+  munmap (map, mapSize);
+}
+
+
+// Member methods
+
+
+// one Measure, as a record
+void MeasureWriter::Write (Measure m)
+{
+  Record  r;
+
+  r.unit = GetId (m.GetUnit());
+  r.reserved = 0;
+  r.quantity = m.GetQuantity();
+  pending.push_back (r);
+  if (pending.size() == RECORDBLOCKSIZE) WritePending();
+}
+
+
+// a whole array, as a column
+void MeasureWriter::Write (MeasureArray & a)
+{
+  Write (a.GetUnit(), a.GetQuantities(), a.GetSize());
+}
+
+
+// n quantities in Unit u, as a column
+void MeasureWriter::Write (Unit * u, const double * q, size_t n)
+{
+  uint32_t  id = GetId (u);
+
+  WritePending();
+  WriteBlock ('C', id, n, q, n * sizeof (double), ALIGNMENT);
+}
+
+
+// get everything written so far out to the file
+void MeasureWriter::Flush (void)
+{
+  WritePending();
+  if (fflush (file) != 0) throw IOError (path, errno);
+}
+
+
+// finish the file.  nothing more may be written.
+void MeasureWriter::Close (void)
+{
+  FILE *  f = file;
+
+  if (f == NULL) return;
+  WritePending();
+  file = NULL;
+  if (fclose (f) != 0) throw IOError (path, errno);
+}
+
+
+// column block b, right where it is in the file
+MeasureView MeasureReader::GetColumn (size_t b)
+{
+  Block &  k = blocks[b];
+
+  if (k.type != 'C') throw FormatError (path, "not a column block");
+  return MeasureView (k.unit, (const double *) k.data, k.count);
+}
+
+
+// the i'th Measure of block b, whichever kind it is
+Measure MeasureReader::Get (size_t b, size_t i)
+{
+  Block &  k = blocks[b];
+  Record   r;
+
+  if (k.type == 'C') return Measure (((const double *) k.data)[i], k.unit);
+  memcpy (&r, k.data + i * sizeof (Record), sizeof (r));
+  return Measure (r.quantity, GetUnit (r.unit));
+}
+
+
+// whether Next has given every Measure in the file
+int MeasureReader::AtEnd (void)
+{
+  while (nextBlock < blocks.size() && nextIndex >= blocks[nextBlock].count)
+  {
+    nextBlock++;
+    nextIndex = 0;
+  }
+  return nextBlock == blocks.size();
+}
+
+
+// the next Measure in the file, in the order they were written
+// (or a unitless Measure, if there are no more)
+Measure MeasureReader::Next (void)
+{
+  if (AtEnd()) return Measure();
+  return Get (nextBlock, nextIndex++);
+}
+
+
+// the Units the file uses, say for ReclaimTemps to keep
+UnitVector MeasureReader::GetUnits (void)
+{
+  return UnitVector (units.begin(), units.end());
+}
+
+
+// PROTECTED STUFF
+
+
+// Member methods
+
+
+// the id u goes by in this file, writing it (and any base units it
+// needs) to the dictionary if it's new.  (a Measure of no Unit yet, like
+// the one MeasureReader::Next gives at the end, goes in as unitless.)
+uint32_t MeasureWriter::GetId (Unit * u)
+{
+  Dimension        d = ((u != NULL) ? u : &Unit::UNITLESS)->GetDimension();
+  IdMap::iterator  it;
+  uint32_t         id;
+  int              slot;
+  signed char      exps[MAXBASEUNITS];
+
+  if (lastId != NOID && d == lastDims) return lastId;
+  it = ids.find (d);
+  if (it != ids.end()) id = it->second;
+  else
+  {
+    for (slot = 0; slot < MAXBASEUNITS; slot++)
+    {
+      exps[slot] = d.GetExponent (slot);
+      if (exps[slot] != 0 && ! baseWritten[slot])
+      {
+        Unit *  b = Unit::GetBaseUnit (slot);
+        string  name;
+
+        if (b == NULL) throw FormatError (path, "base unit was destroyed");
+        name = b->GetName();
+        WriteBlock ('B', slot, name.size(), name.data(), name.size(), 8);
+        baseWritten[slot] = 1;
+      }
+    }
+    id = ids.size();
+    WriteBlock ('U', id, MAXBASEUNITS, exps, sizeof (exps), 8);
+    ids[d] = id;
+  }
+  lastDims = d;
+  lastId = id;
+  return id;
+}
+
+
+// a block header, then size bytes of data starting at a multiple of
+// align, then padding to a multiple of 8
+void MeasureWriter::WriteBlock (uint32_t type, uint32_t id, uint64_t count,
+                                const void * data, size_t size, size_t align)
+{
+  static const char  zeros[ALIGNMENT] = { 0 };
+  BlockHeader        h;
+
+  if (file == NULL) throw IOError (path, EBADF);
+  h.type = type;
+  h.id = id;
+  h.count = count;
+  WriteBytes (&h, sizeof (h));
+  WriteBytes (zeros, Padding (offset, align));
+  WriteBytes (data, size);
+  WriteBytes (zeros, Padding (offset, 8));
+}
+
+
+void MeasureWriter::WriteBytes (const void * data, size_t size)
+{
+  if (size != 0 && fwrite (data, 1, size, file) != size)
+  {
+    throw IOError (path, errno);
+  }
+  offset += size;
+}
+
+
+// the records saved up so far, as one block
+void MeasureWriter::WritePending (void)
+{
+  if (pending.empty()) return;
+  WriteBlock ('R', 0, pending.size(), pending.data(),
+              pending.size() * sizeof (Record), 8);
+  pending.clear();
+}
+
+
+// check the header, then go through the blocks: find the Units in the
+// dictionary, and note where the records and columns are.  only the
+// block headers are looked at, not what's in them.
+void MeasureReader::Scan (void)
+{
+  FileHeader  h;
+  size_t      off = sizeof (h);
+
+  memcpy (&h, map, sizeof (h));
+  if (memcmp (h.magic, "MEASURES", sizeof (h.magic)) != 0)
+  {
+    throw FormatError (path, "not a measure file");
+  }
+  if (h.version != MEASUREFILEVERSION)
+  {
+    throw FormatError (path, "unknown version");
+  }
+  if (h.byteOrder != 0x01020304) throw FormatError (path, "wrong byte order");
+  // (the mapping is page aligned, so data the file aligns, is)
+  if (h.alignment == 0 || (h.alignment & (h.alignment - 1)) != 0 ||
+      h.alignment > 4096 || h.maxBaseUnits > 256)
+  {
+    throw FormatError (path, "bad header");
+  }
+  while (off < mapSize)
+  {
+    BlockHeader   b;
+    const char *  data;
+    size_t        left;
+    Block         k;
+
+    if (mapSize - off < sizeof (b)) throw FormatError (path, "truncated");
+    memcpy (&b, map + off, sizeof (b));
+    off += sizeof (b);
+    if (b.type == 'C') off += Padding (off, h.alignment);
+    if (off > mapSize) throw FormatError (path, "truncated");
+    data = map + off;
+    left = mapSize - off;
+    switch (b.type)
+    {
+    case 'B':
+      {
+        string  name;
+        Unit *  u;
+        int     slot;
+
+        if (b.count > left) throw FormatError (path, "truncated");
+        if (b.id >= h.maxBaseUnits) throw FormatError (path, "bad slot");
+        name.assign (data, b.count);
+        u = Unit::FindUnitByName (name);
+        for (slot = 0; u != NULL && slot < MAXBASEUNITS; slot++)
+        {
+          if (u->GetDimension() == Dimension::Base (slot)) break;
+        }
+        if (u == NULL || slot == MAXBASEUNITS) throw UnknownUnitError (name);
+        if (slots.size() <= b.id) slots.resize (b.id + 1, -1);
+        slots[b.id] = slot;
+        off += b.count;
+      }
+      break;
+    case 'U':
+      {
+        Dimension  d;
+        size_t     i;
+
+        if (b.count != h.maxBaseUnits || b.count > left)
+        {
+          throw FormatError (path, "bad unit");
+        }
+        if (b.id != units.size()) throw FormatError (path, "bad unit id");
+        for (i = 0; i < b.count; i++)
+        {
+          int        e = (signed char) data[i];
+          Dimension  p;
+
+          if (e == 0) continue;
+          if (i >= slots.size() || slots[i] < 0)
+          {
+            throw FormatError (path, "unit uses an undeclared base unit");
+          }
+          if (! Dimension::Base (slots[i]).Power (e, &p) ||
+              ! d.Buildup ('*', p, &d))
+          {
+            throw FormatError (path, "bad unit");
+          }
+        }
+        units.push_back (Unit::FindUnitByDimension (d));
+        off += b.count;
+      }
+      break;
+    case 'R':
+    case 'C':
+      {
+        size_t  each = (b.type == 'R') ? sizeof (Record) : sizeof (double);
+
+        if (b.count > left / each) throw FormatError (path, "truncated");
+        k.type = b.type;
+        k.unit = (b.type == 'C') ? GetUnit (b.id) : NULL;
+        k.count = b.count;
+        k.data = data;
+        blocks.push_back (k);
+        total += b.count;
+        off += b.count * each;
+      }
+      break;
+    default:
+      throw FormatError (path, "unknown block type");
+    }
+    off += Padding (off, 8);
+  }
+}
+
+
+// the Unit the file calls id
+Unit * MeasureReader::GetUnit (uint32_t id)
+{
+  if (id >= units.size()) throw FormatError (path, "undefined unit id");
+  return units[id];
+}
+
+
+// END OF FILE
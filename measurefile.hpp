@@ -0,0 +1,220 @@
+/*
+measurefile.hpp (Copyright 2003 David J. Aronson)
+Saving lots of Measures to a binary file, and mapping them back in without
+any parsing.
+See also measurefile.cpp, measurearray.*
+*/
+
+#ifndef MEASUREFILE_H
+#define MEASUREFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "measure.hpp"
+#include "measurearray.hpp"
+#include "simd.hpp"
+#include "unit.hpp"
+
+using namespace std;
+
+
+// how many (unit, quantity) records a MeasureWriter saves up before
+// writing them out as one block
+#define RECORDBLOCKSIZE 4096
+
+// bumped whenever the layout below changes
+#define MEASUREFILEVERSION 1
+
+
+// The file is a header, then a series of blocks, each starting with a
+// BlockHeader:
+//   'B' base unit: id is its slot, then count bytes of its name
+//   'U' unit: id is what records and columns call it, then count
+//       exponents (signed chars), one per base unit slot
+//   'R' records: count Records, each a unit id and a quantity
+//   'C' column: count quantities, all in unit id, starting at an offset
+//       that's a multiple of ALIGNMENT
+// Each block is padded to a multiple of 8 bytes.  A unit (or base unit)
+// is written the first time it's used, before anything that uses it.
+// Everything is in the writer's byte order; a reader on a machine with
+// the other order refuses the file.
+class MeasureFile
+{
+public:
+  // Exception classes
+  class IOError
+  {
+  public:
+    string  path;
+    int     err;      // errno
+    IOError (string p, int e)
+    {
+      path = p;
+      err = e;
+    }
+  };
+  class FormatError
+  {
+  public:
+    string  path;
+    string  problem;
+    FormatError (string p, string s)
+    {
+      path = p;
+      problem = s;
+    }
+  };
+  class UnknownUnitError
+  {
+  public:
+    string  name;     // of a base unit the file uses, but we don't have
+    UnknownUnitError (string n) { name = n; }
+  };
+protected:
+  struct FileHeader
+  {
+    char      magic[8];       // "MEASURES"
+    uint32_t  version;
+    uint32_t  byteOrder;      // 0x01020304, as written
+    uint32_t  maxBaseUnits;   // exponents per 'U' block
+    uint32_t  alignment;      // of 'C' quantities
+  };
+  struct BlockHeader
+  {
+    uint32_t  type;
+    uint32_t  id;
+    uint64_t  count;
+  };
+  struct Record
+  {
+    uint32_t  unit;
+    uint32_t  reserved;
+    double    quantity;
+  };
+  // Static methods
+  static size_t  Padding (size_t offset, size_t align)
+                 { return (align - offset % align) % align; }
+};
+
+
+// Writes a measure file.  Single Measures are saved up into record
+// blocks; whole arrays go straight out as column blocks.  Either way,
+// the order they're written in is the order they're read back in.
+class MeasureWriter : public MeasureFile
+{
+public:
+  // Constructors
+  MeasureWriter (string p);
+  MeasureWriter (const MeasureWriter & w) = delete;
+  // Destructor
+  ~MeasureWriter (void);
+  // Member methods
+  void  Write (Measure m);
+  void  Write (MeasureArray & a);
+  void  Write (Unit * u, const double * q, size_t n);
+  void  Flush (void);
+  void  Close (void);
+protected:
+  struct DimensionHash
+  {
+    size_t  operator () (const Dimension & d) const { return d.Hash(); }
+  };
+  typedef unordered_map <Dimension, uint32_t, DimensionHash>  IdMap;
+  // Member data
+  string           path;
+  FILE *           file;
+  size_t           offset;        // how much has been written
+  IdMap            ids;           // unit ids so far, by dimension
+  vector <char>    baseWritten;   // by slot
+  Dimension        lastDims;      // the last unit looked up, and its id
+  uint32_t         lastId;
+  vector <Record>  pending;       // records not yet written
+  // Member methods
+  uint32_t  GetId (Unit * u);
+  void      WriteBlock (uint32_t type, uint32_t id, uint64_t count,
+                        const void * data, size_t size, size_t align);
+  void      WriteBytes (const void * data, size_t size);
+  void      WritePending (void);
+};
+
+
+// Quantities in one Unit, as a column block in a mapped file: like a
+// MeasureArray, but read-only, and only good while the reader is.
+class MeasureView
+{
+public:
+  // Constructors
+  MeasureView (void) { unit = NULL; quantity = NULL; size = 0; }
+  MeasureView (Unit * u, const double * q, size_t n)
+              { unit = u; quantity = q; size = n; }
+  // Member methods
+  size_t          GetSize (void) { return size; }
+  Unit *          GetUnit (void) { return unit; }
+  const double *  GetQuantities (void) { return quantity; }
+  Measure         Get (size_t i) { return Measure (quantity[i], unit); }
+  MeasureArray    ToArray (void)
+                  { return MeasureArray (unit, quantity, size); }
+protected:
+  // Member data
+  Unit *          unit;
+  const double *  quantity;     // aligned to ALIGNMENT bytes
+  size_t          size;
+};
+
+
+// Reads a measure file by mapping it into memory: opening it only looks
+// at the block headers and unit dictionary, and column blocks are used
+// right where they lie.  The Units the file uses are found (or made, as
+// temps) when it's opened; don't reclaim them while it's open (see
+// GetUnits).
+class MeasureReader : public MeasureFile
+{
+public:
+  // Constructors
+  MeasureReader (string p);
+  MeasureReader (const MeasureReader & r) = delete;
+  // Destructor
+  ~MeasureReader (void);
+  // Member methods
+  size_t       GetSize (void) { return total; }
+  size_t       GetBlockCount (void) { return blocks.size(); }
+  size_t       GetBlockSize (size_t b) { return blocks[b].count; }
+  int          IsColumn (size_t b) { return blocks[b].type == 'C'; }
+  MeasureView  GetColumn (size_t b);
+  Measure      Get (size_t b, size_t i);
+  int          AtEnd (void);
+  Measure      Next (void);
+  void         Rewind (void) { nextBlock = 0; nextIndex = 0; }
+  UnitVector   GetUnits (void);
+protected:
+  struct Block
+  {
+    uint32_t      type;       // 'R' or 'C'
+    Unit *        unit;       // for 'C'
+    size_t        count;
+    const char *  data;
+  };
+  // Member data
+  string           path;
+  char *           map;
+  size_t           mapSize;
+  vector <Unit *>  units;       // by id
+  vector <int>     slots;       // our slot for each of the file's
+  vector <Block>   blocks;      // just records and columns
+  size_t           total;
+  size_t           nextBlock;   // for Next
+  size_t           nextIndex;
+  // Member methods
+  void    Scan (void);
+  Unit *  GetUnit (uint32_t id);
+};
+
+
+#endif // ifndef MEASUREFILE_H
+
+
+// END OF FILE
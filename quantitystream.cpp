@@ -0,0 +1,121 @@
+/*
+quantitystream.cpp (Copyright 2003 David J. Aronson)
+Reading lots of quantities from a file, crunching them a MeasureArray at a
+time, and writing the results -- the batch modes of the sample programs.
+See also quantitystream.hpp, measurearray.*
+*/
+
+#include <charconv>
+#include <string.h>
+
+#include "quantitystream.hpp"
+
+
+// what goes between quantities.  (not strchr on a string of them, which
+// would take the NUL at its end for one too)
+static inline int IsSeparator (char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' ||
+         c == ';';
+}
+
+
+// crunch a whole chunk at once, and add the results to the output
+static void FlushChunk (MeasureArray * chunk, size_t n, ChunkFunction & f,
+                        FILE * out, char * outBuf, size_t * outLen)
+{
+  MeasureArray  results = f (*chunk);
+  double *      q = results.GetQuantities();
+  size_t        i;
+
+  for (i = 0; i < n; i++)
+  {
+    // room for the longest double, plus a newline
+    if (*outLen + 32 > OUTBUFSIZE)
+    {
+      fwrite (outBuf, 1, *outLen, out);
+      *outLen = 0;
+    }
+    // (shortest form that reads back as the same double)
+    *outLen = to_chars (outBuf + *outLen, outBuf + OUTBUFSIZE, q[i]).ptr
+              - outBuf;
+    outBuf[(*outLen)++] = '\n';
+  }
+}
+
+
+int StreamQuantities (FILE * in, FILE * out, Unit * u, ChunkFunction f,
+                      int allowNegative, string * bad)
+{
+  static char   inBuf[INBUFSIZE];
+  static char   outBuf[OUTBUFSIZE];
+  MeasureArray  chunk (u, CHUNKSIZE);
+  double *      q = chunk.GetQuantities();
+  size_t        n = 0;
+  size_t        kept = 0;    // leftover partial number from last read
+  size_t        outLen = 0;
+  size_t        got;
+  int           atEnd = 0;
+  int           ok = 1;
+
+  while (ok && ! atEnd)
+  {
+    const char *  p = inBuf;
+    const char *  end;
+
+    got = fread (inBuf + kept, 1, INBUFSIZE - kept, in);
+    atEnd = (got == 0);
+    end = inBuf + kept + got;
+    // unless that's all there is, the last number might be cut off, so
+    // only parse up to the last separator (a pipe may give us less than
+    // a whole number; a full buffer with no separator is no number)
+    if (! atEnd)
+    {
+      while (end > inBuf && ! IsSeparator (end[-1])) end--;
+      if (end == inBuf && kept + got == INBUFSIZE)
+      {
+        *bad = string (inBuf, 32) + "...";
+        ok = 0;
+        break;
+      }
+    }
+    while (p < end)
+    {
+      from_chars_result  r;
+      const char *       start = p;
+
+      if (IsSeparator (*p))
+      {
+        p++;
+        continue;
+      }
+      // from_chars won't take a leading plus sign, so skip it -- unless
+      // another sign follows, as in "+-5", which is no number
+      if (*p == '+' && p + 1 < end && p[1] != '-' && p[1] != '+') p++;
+      r = from_chars (p, end, q[n]);
+      if (r.ec != errc() || (r.ptr < end && ! IsSeparator (*r.ptr)) ||
+          (q[n] < 0 && ! allowNegative))
+      {
+        for (p = start; p < end && ! IsSeparator (*p); p++) { }
+        *bad = string (start, p);
+        ok = 0;
+        break;
+      }
+      p = r.ptr;
+      if (++n == CHUNKSIZE)
+      {
+        FlushChunk (&chunk, n, f, out, outBuf, &outLen);
+        n = 0;
+      }
+    }
+    kept = inBuf + kept + got - end;
+    memmove (inBuf, end, kept);
+  }
+  FlushChunk (&chunk, n, f, out, outBuf, &outLen);
+  fwrite (outBuf, 1, outLen, out);
+  fflush (out);
+  return ok;
+}
+
+
+// END OF FILE
@@ -0,0 +1,48 @@
+/*
+quantitystream.hpp (Copyright 2003 David J. Aronson)
+Reading lots of quantities from a file, crunching them a MeasureArray at a
+time, and writing the results -- the batch modes of the sample programs.
+See also quantitystream.cpp, measurearray.*
+*/
+
+#ifndef QUANTITYSTREAM_H
+#define QUANTITYSTREAM_H
+
+#include <functional>
+#include <stdio.h>
+#include <string>
+
+#include "measurearray.hpp"
+
+class Unit;
+
+using namespace std;
+
+
+// how much input to read at a time, how many quantities to crunch at a
+// time, and how much output to save up before writing
+#define INBUFSIZE  (1 << 20)
+#define CHUNKSIZE  (1 << 14)
+#define OUTBUFSIZE (1 << 20)
+
+
+// What to do with each chunk: given a MeasureArray of CHUNKSIZE
+// quantities (in the input Unit), return the results.  Only the first
+// however-many-were-read are written out; the rest are left over from
+// the chunk before, and are harmless to crunch.
+typedef function <MeasureArray (MeasureArray &)>  ChunkFunction;
+
+
+// Read every quantity in "in" (separated by whitespace, commas, or
+// semicolons) as a Unit u, run them through f a chunk at a time, and
+// write the results to "out", one per line.  Returns 1 if all went well,
+// or 0 if a quantity was no good (or negative, unless allowed), in which
+// case *bad gets it, and the results before it have been written.
+int  StreamQuantities (FILE * in, FILE * out, Unit * u, ChunkFunction f,
+                       int allowNegative, string * bad);
+
+
+#endif // ifndef QUANTITYSTREAM_H
+
+
+// END OF FILE
@@ -0,0 +1,238 @@
+/*
+reduction.cpp (Copyright 2003 David J. Aronson)
+Sums, means, extremes, dot products and norms of lots of Measures at
+once, spread over a ThreadPool.
+See also reduction.hpp, threadpool.*, measurearray.*
+*/
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "reduction.hpp"
+#include "simd.hpp"
+
+
+// PUBLIC STUFF
+
+
+// Static methods
+
+
+Measure Reduction::Sum (MeasureArray & a, ThreadPool * pool)
+{
+  return Measure (Reduce (SUM, a.GetQuantities(), NULL, a.GetSize(), pool),
+                  a.GetUnit());
+}
+
+
+Measure Reduction::Mean (MeasureArray & a, ThreadPool * pool)
+{
+  if (a.GetSize() == 0) throw EmptyError();
+  return Measure (Reduce (SUM, a.GetQuantities(), NULL, a.GetSize(), pool) /
+                  a.GetSize(), a.GetUnit());
+}
+
+
+Measure Reduction::Min (MeasureArray & a, ThreadPool * pool)
+{
+  if (a.GetSize() == 0) throw EmptyError();
+  return Measure (Reduce (MIN, a.GetQuantities(), NULL, a.GetSize(), pool),
+                  a.GetUnit());
+}
+
+
+Measure Reduction::Max (MeasureArray & a, ThreadPool * pool)
+{
+  if (a.GetSize() == 0) throw EmptyError();
+  return Measure (Reduce (MAX, a.GetQuantities(), NULL, a.GetSize(), pool),
+                  a.GetUnit());
+}
+
+
+// the sum of the products, in the product of the Units: meters dot
+// newtons is joules
+Measure Reduction::Dot (MeasureArray & a, MeasureArray & b, ThreadPool * pool)
+{
+  Unit *  u;
+
+  if (a.GetSize() != b.GetSize())
+  {
+    throw MeasureArray::SizeMismatchError (a.GetSize(), b.GetSize());
+  }
+  u = Unit::FindUnitByBuildup (a.GetUnit(), '*', b.GetUnit());
+  return Measure (Reduce (DOT, a.GetQuantities(), b.GetQuantities(),
+                          a.GetSize(), pool), u);
+}
+
+
+// the square root of a dot a, in a's Unit
+Measure Reduction::Norm (MeasureArray & a, ThreadPool * pool)
+{
+  return Measure (sqrt (Reduce (DOT, a.GetQuantities(), a.GetQuantities(),
+                                a.GetSize(), pool)), a.GetUnit());
+}
+
+
+Measure Reduction::Sum (const Measure * m, size_t n, ThreadPool * pool)
+{
+  if (n == 0) throw EmptyError();
+  return Measure (Reduce (SUM, m, NULL, n, pool), m[0].GetUnit());
+}
+
+
+Measure Reduction::Mean (const Measure * m, size_t n, ThreadPool * pool)
+{
+  if (n == 0) throw EmptyError();
+  return Measure (Reduce (SUM, m, NULL, n, pool) / n, m[0].GetUnit());
+}
+
+
+Measure Reduction::Min (const Measure * m, size_t n, ThreadPool * pool)
+{
+  if (n == 0) throw EmptyError();
+  return Measure (Reduce (MIN, m, NULL, n, pool), m[0].GetUnit());
+}
+
+
+Measure Reduction::Max (const Measure * m, size_t n, ThreadPool * pool)
+{
+  if (n == 0) throw EmptyError();
+  return Measure (Reduce (MAX, m, NULL, n, pool), m[0].GetUnit());
+}
+
+
+Measure Reduction::Dot (const Measure * a, const Measure * b, size_t n,
+                        ThreadPool * pool)
+{
+  Unit *  u;
+
+  if (n == 0) throw EmptyError();
+  u = Unit::FindUnitByBuildup (a[0].GetUnit(), '*', b[0].GetUnit());
+  return Measure (Reduce (DOT, a, b, n, pool), u);
+}
+
+
+Measure Reduction::Norm (const Measure * m, size_t n, ThreadPool * pool)
+{
+  if (n == 0) throw EmptyError();
+  return Measure (sqrt (Reduce (DOT, m, m, n, pool)), m[0].GetUnit());
+}
+
+
+// PROTECTED STUFF
+
+
+// Static methods
+
+
+// reduce n quantities (or, for DOT, n pairs), a block at a time on the
+// pool, then put the blocks together
+double Reduction::Reduce (Kind k, const double * a, const double * b,
+                          size_t n, ThreadPool * pool)
+{
+  size_t           blocks = (n + REDUCEBLOCK - 1) / REDUCEBLOCK;
+  vector <double>  partial (blocks);
+
+  if (pool == NULL) pool = ThreadPool::GetDefault();
+  pool->ParallelFor (blocks, REDUCEGRAIN,
+                     [&] (size_t begin, size_t end)
+                     {
+                       for (; begin < end; begin++)
+                       {
+                         size_t  at = begin * REDUCEBLOCK;
+
+                         partial[begin] = Block (k, a + at,
+                                                 (b != NULL) ? b + at : NULL,
+                                                 min ((size_t) REDUCEBLOCK,
+                                                      n - at));
+                       }
+                     });
+  return Combine (k, partial.data(), blocks);
+}
+
+
+// the same for Measures one by one: each block's quantities are copied
+// out (checking their Units on the way) and reduced just as above.
+// throws Unit::MismatchError if any Unit isn't the first one's.
+double Reduction::Reduce (Kind k, const Measure * a, const Measure * b,
+                          size_t n, ThreadPool * pool)
+{
+  size_t           blocks = (n + REDUCEBLOCK - 1) / REDUCEBLOCK;
+  vector <double>  partial (blocks);
+  atomic <size_t>  badA (n);     // where a mismatch was, if anywhere
+  atomic <size_t>  badB (n);
+
+  if (pool == NULL) pool = ThreadPool::GetDefault();
+  pool->ParallelFor (blocks, REDUCEGRAIN,
+                     [&] (size_t begin, size_t end)
+                     {
+                       double  qa[REDUCEBLOCK];
+                       double  qb[REDUCEBLOCK];
+
+                       for (; begin < end; begin++)
+                       {
+                         size_t  at = begin * REDUCEBLOCK;
+                         size_t  size = min ((size_t) REDUCEBLOCK, n - at);
+                         size_t  i;
+
+                         for (i = 0; i < size; i++)
+                         {
+                           qa[i] = a[at + i].GetQuantity();
+                           if (a[at + i].GetUnitId() != a[0].GetUnitId())
+                           {
+                             badA.store (at + i);
+                           }
+                         }
+                         for (i = 0; b != NULL && i < size; i++)
+                         {
+                           qb[i] = b[at + i].GetQuantity();
+                           if (b[at + i].GetUnitId() != b[0].GetUnitId())
+                           {
+                             badB.store (at + i);
+                           }
+                         }
+                         partial[begin] = Block (k, qa, (b != NULL) ? qb
+                                                                    : NULL,
+                                                 size);
+                       }
+                     });
+  if (badA.load() != n)
+  {
+    throw Unit::MismatchError (a[badA.load()].GetUnit(), a[0].GetUnit());
+  }
+  if (badB.load() != n)
+  {
+    throw Unit::MismatchError (b[badB.load()].GetUnit(), b[0].GetUnit());
+  }
+  return Combine (k, partial.data(), blocks);
+}
+
+
+// one block, with one SIMD kernel
+double Reduction::Block (Kind k, const double * a, const double * b,
+                         size_t n)
+{
+  if (k == SUM) return SimdSum (a, n);
+  if (k == DOT) return SimdDot (a, b, n);
+  if (k == MIN) return SimdMin (a, n);
+  return SimdMax (a, n);
+}
+
+
+// the blocks' results, put together: extremes of extremes, or sums
+// added up pairwise (halving by position, so the same count always adds
+// up the same way)
+double Reduction::Combine (Kind k, const double * partial, size_t n)
+{
+  size_t  h = n / 2;
+
+  if (k == MIN) return SimdMin (partial, n);
+  if (k == MAX) return SimdMax (partial, n);
+  if (n == 0) return 0;
+  if (n == 1) return partial[0];
+  return Combine (k, partial, h) + Combine (k, partial + h, n - h);
+}
+
+
+// END OF FILE
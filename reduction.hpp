@@ -0,0 +1,82 @@
+/*
+reduction.hpp (Copyright 2003 David J. Aronson)
+Sums, means, extremes, dot products and norms of lots of Measures at
+once, spread over a ThreadPool.
+See also reduction.cpp, threadpool.*, measurearray.*
+*/
+
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#include <stddef.h>
+
+#include "measure.hpp"
+#include "measurearray.hpp"
+#include "threadpool.hpp"
+#include "unit.hpp"
+
+using namespace std;
+
+
+// how many quantities go into each partial result; see Reduction
+#define REDUCEBLOCK 4096
+
+// how many blocks a thread takes at a time
+#define REDUCEGRAIN 4
+
+
+// Each of these checks (or works out) the Unit once, then cuts the
+// quantities into blocks of REDUCEBLOCK, has the pool's threads reduce
+// the blocks with SIMD kernels, and puts the blocks' results together.
+// Sums are added up pairwise: within a block, in eight lanes, and then
+// the blocks, in a tree whose shape depends only on how many blocks
+// there are.  So a sum comes out exactly the same on one thread or
+// many, whatever the instruction set, and its error grows with log n,
+// not n.
+//
+// The Measure * versions are for Measures kept one by one (each with
+// its own Unit id, all of which must match).  They give exactly
+// what the MeasureArray versions give for the same quantities.
+//
+// pool is the one to use, or NULL for ThreadPool::GetDefault.
+class Reduction
+{
+public:
+  // Static methods
+  static Measure  Sum (MeasureArray & a, ThreadPool * pool = NULL);
+  static Measure  Mean (MeasureArray & a, ThreadPool * pool = NULL);
+  static Measure  Min (MeasureArray & a, ThreadPool * pool = NULL);
+  static Measure  Max (MeasureArray & a, ThreadPool * pool = NULL);
+  static Measure  Dot (MeasureArray & a, MeasureArray & b,
+                       ThreadPool * pool = NULL);
+  static Measure  Norm (MeasureArray & a, ThreadPool * pool = NULL);
+  static Measure  Sum (const Measure * m, size_t n, ThreadPool * pool = NULL);
+  static Measure  Mean (const Measure * m, size_t n, ThreadPool * pool = NULL);
+  static Measure  Min (const Measure * m, size_t n, ThreadPool * pool = NULL);
+  static Measure  Max (const Measure * m, size_t n, ThreadPool * pool = NULL);
+  static Measure  Dot (const Measure * a, const Measure * b, size_t n,
+                       ThreadPool * pool = NULL);
+  static Measure  Norm (const Measure * m, size_t n,
+                        ThreadPool * pool = NULL);
+  // Exception classes
+  // (the mean, min, or max of no Measures; or anything of no Measures,
+  // for the Measure * versions, since there's no Unit to give it)
+  class EmptyError { };
+protected:
+  // the kinds of reduction
+  enum Kind { SUM, MIN, MAX, DOT };
+  // Static methods
+  static double  Reduce (Kind k, const double * a, const double * b,
+                         size_t n, ThreadPool * pool);
+  static double  Reduce (Kind k, const Measure * a, const Measure * b,
+                         size_t n, ThreadPool * pool);
+  static double  Block (Kind k, const double * a, const double * b,
+                        size_t n);
+  static double  Combine (Kind k, const double * partial, size_t n);
+};
+
+
+#endif // ifndef REDUCTION_H
+
+
+// END OF FILE
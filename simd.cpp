@@ -0,0 +1,562 @@
+/*
+simd.cpp (Copyright 2003 David J. Aronson)
+Element-wise kernels over arrays of doubles.
+See also simd.hpp
+*/
+
+#include <math.h>
+
+#include "simd.hpp"
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+
+#define OP_ADD 0
+#define OP_SUB 1
+#define OP_MUL 2
+#define OP_DIV 3
+#define OP_MIN 4
+#define OP_MAX 5
+
+// how many running results the reductions keep.  (for every level to
+// get the same sums, multiplies and adds mustn't be fused on the quiet;
+// -std=c++20, rather than gnu++20, sees to that.)
+#define LANES 8
+
+
+// PLAIN LOOPS -- for anything the vector loops leave over at the end,
+// and for CPUs with no vector instructions we know about
+
+
+template <int OP> static inline double Apply (double a, double b)
+{
+  if (OP == OP_ADD) return a + b;
+  if (OP == OP_SUB) return a - b;
+  if (OP == OP_MUL) return a * b;
+  return a / b;
+}
+
+
+// bStep is 1 to walk b along with a, or 0 to use b[0] throughout
+template <int OP> static void BinaryPlain (const double * a, const double * b,
+                                           int bStep, double * out,
+                                           size_t i, size_t n)
+{
+  for (; i < n; i++) out[i] = Apply <OP> (a[i], b[i * bStep]);
+}
+
+
+// put a sum's (or dot product's) lanes together; always the same way
+static inline double AddLanes (const double * l)
+{
+  return ((l[0] + l[1]) + (l[2] + l[3])) + ((l[4] + l[5]) + (l[6] + l[7]));
+}
+
+
+// one lane's step of a min or max: x if it wins, else m.  (this is just
+// what MINPD and MAXPD do, NaNs included.)
+template <int OP> static inline double Pick (double x, double m)
+{
+  if (OP == OP_MIN) return (x < m) ? x : m;
+  return (x > m) ? x : m;
+}
+
+
+template <int OP> static inline double PickLanes (const double * l)
+{
+  double  m = l[0];
+  int     j;
+
+  for (j = 1; j < LANES; j++) m = Pick <OP> (l[j], m);
+  return m;
+}
+
+
+// the leftovers past the last whole LANES, into their lanes
+static inline void SumTail (const double * a, const double * b, double * l,
+                            size_t i, size_t n)
+{
+  int  j;
+
+  for (j = 0; i + j < n; j++) l[j] += (b != NULL) ? a[i + j] * b[i + j]
+                                                  : a[i + j];
+}
+
+
+// a sum, or (if b isn't NULL) a dot product
+static double SumPlain (const double * a, const double * b, size_t n)
+{
+  double  l[LANES] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  size_t  i = 0;
+  int     j;
+
+  for (; i + LANES <= n; i += LANES)
+  {
+    for (j = 0; j < LANES; j++) l[j] += (b != NULL) ? a[i + j] * b[i + j]
+                                                    : a[i + j];
+  }
+  SumTail (a, b, l, i, n);
+  return AddLanes (l);
+}
+
+
+template <int OP> static double PickPlain (const double * a, size_t n)
+{
+  double  l[LANES];
+  size_t  i = 0;
+  int     j;
+
+  for (j = 0; j < LANES; j++) l[j] = a[0];
+  for (; i + LANES <= n; i += LANES)
+  {
+    for (j = 0; j < LANES; j++) l[j] = Pick <OP> (a[i + j], l[j]);
+  }
+  for (j = 0; i + j < n; j++) l[j] = Pick <OP> (a[i + j], l[j]);
+  return PickLanes <OP> (l);
+}
+
+
+// x to the (non-negative) p, by repeated squaring
+static inline double PowerPlain (double x, unsigned p)
+{
+  double  r = 1;
+
+  for (; p != 0; p >>= 1)
+  {
+    if (p & 1) r *= x;
+    x *= x;
+  }
+  return r;
+}
+
+
+#ifdef SIMD_X86
+
+
+// AVX2 -- four doubles at a time.  Compiled for AVX2 regardless of the
+// -m flags, and only called if the CPU turns out to have it.
+
+
+template <int OP> __attribute__ ((target ("avx2")))
+static void BinaryAVX2 (const double * a, const double * b, int bStep,
+                        double * out, size_t n)
+{
+  size_t   i = 0;
+  __m256d  x, y, r;
+
+  for (; i + 4 <= n; i += 4)
+  {
+    x = _mm256_loadu_pd (a + i);
+    y = bStep ? _mm256_loadu_pd (b + i) : _mm256_set1_pd (*b);
+    if (OP == OP_ADD) r = _mm256_add_pd (x, y);
+    else if (OP == OP_SUB) r = _mm256_sub_pd (x, y);
+    else if (OP == OP_MUL) r = _mm256_mul_pd (x, y);
+    else r = _mm256_div_pd (x, y);
+    _mm256_storeu_pd (out + i, r);
+  }
+  BinaryPlain <OP> (a, b, bStep, out, i, n);
+}
+
+
+__attribute__ ((target ("avx2")))
+static void PowerAVX2 (const double * a, unsigned p, int invert,
+                       double * out, size_t n)
+{
+  size_t    i = 0;
+  __m256d   one = _mm256_set1_pd (1.0);
+
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d   x = _mm256_loadu_pd (a + i);
+    __m256d   r = one;
+    unsigned  q;
+
+    for (q = p; q != 0; q >>= 1)
+    {
+      if (q & 1) r = _mm256_mul_pd (r, x);
+      x = _mm256_mul_pd (x, x);
+    }
+    if (invert) r = _mm256_div_pd (one, r);
+    _mm256_storeu_pd (out + i, r);
+  }
+  for (; i < n; i++) out[i] = invert ? 1.0 / PowerPlain (a[i], p)
+                                     : PowerPlain (a[i], p);
+}
+
+
+__attribute__ ((target ("avx2")))
+static void SqrtAVX2 (const double * a, int invert, double * out, size_t n)
+{
+  size_t   i = 0;
+  __m256d  one = _mm256_set1_pd (1.0);
+
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d  r = _mm256_sqrt_pd (_mm256_loadu_pd (a + i));
+    _mm256_storeu_pd (out + i, invert ? _mm256_div_pd (one, r) : r);
+  }
+  for (; i < n; i++) out[i] = invert ? 1.0 / sqrt (a[i]) : sqrt (a[i]);
+}
+
+
+// the reductions, with the eight lanes in two registers
+__attribute__ ((target ("avx2")))
+static double SumAVX2 (const double * a, const double * b, size_t n)
+{
+  double   l[LANES];
+  size_t   i = 0;
+  __m256d  lo = _mm256_setzero_pd ();
+  __m256d  hi = _mm256_setzero_pd ();
+
+  for (; i + LANES <= n; i += LANES)
+  {
+    __m256d  x = _mm256_loadu_pd (a + i);
+    __m256d  y = _mm256_loadu_pd (a + i + 4);
+
+    if (b != NULL)
+    {
+      x = _mm256_mul_pd (x, _mm256_loadu_pd (b + i));
+      y = _mm256_mul_pd (y, _mm256_loadu_pd (b + i + 4));
+    }
+    lo = _mm256_add_pd (lo, x);
+    hi = _mm256_add_pd (hi, y);
+  }
+  _mm256_storeu_pd (l, lo);
+  _mm256_storeu_pd (l + 4, hi);
+  SumTail (a, b, l, i, n);
+  return AddLanes (l);
+}
+
+
+template <int OP> __attribute__ ((target ("avx2")))
+static double PickAVX2 (const double * a, size_t n)
+{
+  double   l[LANES];
+  size_t   i = 0;
+  int      j;
+  __m256d  lo = _mm256_set1_pd (a[0]);
+  __m256d  hi = lo;
+
+  for (; i + LANES <= n; i += LANES)
+  {
+    __m256d  x = _mm256_loadu_pd (a + i);
+    __m256d  y = _mm256_loadu_pd (a + i + 4);
+
+    if (OP == OP_MIN)
+    {
+      lo = _mm256_min_pd (x, lo);
+      hi = _mm256_min_pd (y, hi);
+    }
+    else
+    {
+      lo = _mm256_max_pd (x, lo);
+      hi = _mm256_max_pd (y, hi);
+    }
+  }
+  _mm256_storeu_pd (l, lo);
+  _mm256_storeu_pd (l + 4, hi);
+  for (j = 0; i + j < n; j++) l[j] = Pick <OP> (a[i + j], l[j]);
+  return PickLanes <OP> (l);
+}
+
+
+// a * m + b, four at a time, with one rounding each.  (any CPU with
+// AVX2 has FMA too, so far, but it's asked about separately anyway.)
+__attribute__ ((target ("avx2,fma")))
+static void FmaAVX2 (const double * a, double m, double b, double * out,
+                     size_t n)
+{
+  size_t   i = 0;
+  __m256d  vm = _mm256_set1_pd (m);
+  __m256d  vb = _mm256_set1_pd (b);
+
+  for (; i + 4 <= n; i += 4)
+  {
+    _mm256_storeu_pd (out + i,
+                      _mm256_fmadd_pd (_mm256_loadu_pd (a + i), vm, vb));
+  }
+  for (; i < n; i++) out[i] = fma (a[i], m, b);
+}
+
+
+// SSE2 -- two doubles at a time.  Every x86-64 has this.
+
+
+template <int OP> __attribute__ ((target ("sse2")))
+static void BinarySSE2 (const double * a, const double * b, int bStep,
+                        double * out, size_t n)
+{
+  size_t   i = 0;
+  __m128d  x, y, r;
+
+  for (; i + 2 <= n; i += 2)
+  {
+    x = _mm_loadu_pd (a + i);
+    y = bStep ? _mm_loadu_pd (b + i) : _mm_set1_pd (*b);
+    if (OP == OP_ADD) r = _mm_add_pd (x, y);
+    else if (OP == OP_SUB) r = _mm_sub_pd (x, y);
+    else if (OP == OP_MUL) r = _mm_mul_pd (x, y);
+    else r = _mm_div_pd (x, y);
+    _mm_storeu_pd (out + i, r);
+  }
+  BinaryPlain <OP> (a, b, bStep, out, i, n);
+}
+
+
+// (the eight lanes in four registers)
+__attribute__ ((target ("sse2")))
+static double SumSSE2 (const double * a, const double * b, size_t n)
+{
+  double   l[LANES];
+  size_t   i = 0;
+  int      j;
+  __m128d  r[LANES / 2];
+
+  for (j = 0; j < LANES / 2; j++) r[j] = _mm_setzero_pd ();
+  for (; i + LANES <= n; i += LANES)
+  {
+    for (j = 0; j < LANES / 2; j++)
+    {
+      __m128d  x = _mm_loadu_pd (a + i + 2 * j);
+
+      if (b != NULL) x = _mm_mul_pd (x, _mm_loadu_pd (b + i + 2 * j));
+      r[j] = _mm_add_pd (r[j], x);
+    }
+  }
+  for (j = 0; j < LANES / 2; j++) _mm_storeu_pd (l + 2 * j, r[j]);
+  SumTail (a, b, l, i, n);
+  return AddLanes (l);
+}
+
+
+__attribute__ ((target ("sse2")))
+static void SqrtSSE2 (const double * a, int invert, double * out, size_t n)
+{
+  size_t   i = 0;
+  __m128d  one = _mm_set1_pd (1.0);
+
+  for (; i + 2 <= n; i += 2)
+  {
+    __m128d  r = _mm_sqrt_pd (_mm_loadu_pd (a + i));
+    _mm_storeu_pd (out + i, invert ? _mm_div_pd (one, r) : r);
+  }
+  for (; i < n; i++) out[i] = invert ? 1.0 / sqrt (a[i]) : sqrt (a[i]);
+}
+
+
+#endif // ifdef SIMD_X86
+
+
+// DISPATCH
+
+
+#define LEVEL_PLAIN 0
+#define LEVEL_SSE2  1
+#define LEVEL_AVX2  2
+
+
+// what the CPU can do; only asked once
+static int GetLevel (void)
+{
+#ifdef SIMD_X86
+  static const int  level = __builtin_cpu_supports ("avx2") ? LEVEL_AVX2
+                            : __builtin_cpu_supports ("sse2") ? LEVEL_SSE2
+                            : LEVEL_PLAIN;
+  return level;
+#else
+  return LEVEL_PLAIN;
+#endif
+}
+
+
+// whether the CPU has fused multiply-add; only asked once
+static int HasFma (void)
+{
+#ifdef SIMD_X86
+  static const int  fma = __builtin_cpu_supports ("fma");
+  return fma;
+#else
+  return 0;
+#endif
+}
+
+
+template <int OP> static void Binary (const double * a, const double * b,
+                                      int bStep, double * out, size_t n)
+{
+#ifdef SIMD_X86
+  if (GetLevel() == LEVEL_AVX2) BinaryAVX2 <OP> (a, b, bStep, out, n);
+  else if (GetLevel() == LEVEL_SSE2) BinarySSE2 <OP> (a, b, bStep, out, n);
+  else
+#endif
+  BinaryPlain <OP> (a, b, bStep, out, 0, n);
+}
+
+
+void SimdAdd (const double * a, const double * b, double * out, size_t n)
+{
+  Binary <OP_ADD> (a, b, 1, out, n);
+}
+
+
+void SimdSub (const double * a, const double * b, double * out, size_t n)
+{
+  Binary <OP_SUB> (a, b, 1, out, n);
+}
+
+
+void SimdMul (const double * a, const double * b, double * out, size_t n)
+{
+  Binary <OP_MUL> (a, b, 1, out, n);
+}
+
+
+void SimdDiv (const double * a, const double * b, double * out, size_t n)
+{
+  Binary <OP_DIV> (a, b, 1, out, n);
+}
+
+
+void SimdAddScalar (const double * a, double b, double * out, size_t n)
+{
+  Binary <OP_ADD> (a, &b, 0, out, n);
+}
+
+
+void SimdSubScalar (const double * a, double b, double * out, size_t n)
+{
+  Binary <OP_SUB> (a, &b, 0, out, n);
+}
+
+
+void SimdMulScalar (const double * a, double b, double * out, size_t n)
+{
+  Binary <OP_MUL> (a, &b, 0, out, n);
+}
+
+
+// (divides, rather than multiplying by 1/b, to match Measure exactly)
+void SimdDivScalar (const double * a, double b, double * out, size_t n)
+{
+  Binary <OP_DIV> (a, &b, 0, out, n);
+}
+
+
+// raise each element to an integer power, by repeated squaring
+void SimdPower (const double * a, int pow, double * out, size_t n)
+{
+  unsigned  p = (pow > 0) ? pow : -(unsigned) pow;  // (INT_MIN too)
+  size_t    i;
+
+#ifdef SIMD_X86
+  if (GetLevel() == LEVEL_AVX2)
+  {
+    PowerAVX2 (a, p, pow < 0, out, n);
+    return;
+  }
+#endif
+  for (i = 0; i < n; i++)
+  {
+    out[i] = (pow < 0) ? 1.0 / PowerPlain (a[i], p) : PowerPlain (a[i], p);
+  }
+}
+
+
+// take the pow'th root of each element.  square roots have vector
+// instructions; cube roots and the rest go one at a time.  (square and
+// cube roots, and their reciprocals, are done as Measure::root does them,
+// so they give the same answers, and cube roots of negatives work.)
+void SimdRoot (const double * a, int pow, double * out, size_t n)
+{
+  size_t  i;
+
+#ifdef SIMD_X86
+  if ((pow == 2 || pow == -2) && GetLevel() != LEVEL_PLAIN)
+  {
+    if (GetLevel() == LEVEL_AVX2) SqrtAVX2 (a, pow < 0, out, n);
+    else SqrtSSE2 (a, pow < 0, out, n);
+    return;
+  }
+#endif
+  if (pow == 1) for (i = 0; i < n; i++) out[i] = a[i];
+  else if (pow == 2) for (i = 0; i < n; i++) out[i] = sqrt (a[i]);
+  else if (pow == 3) for (i = 0; i < n; i++) out[i] = cbrt (a[i]);
+  else if (pow == -2) for (i = 0; i < n; i++) out[i] = 1.0 / sqrt (a[i]);
+  else if (pow == -3) for (i = 0; i < n; i++) out[i] = 1.0 / cbrt (a[i]);
+  else for (i = 0; i < n; i++) out[i] = ::pow (a[i], 1.0 / pow);
+}
+
+
+// scale and shift each element, as affine conversions do.  without FMA
+// instructions, fma() does it in software, one at a time: slower, but
+// the answers are the same.
+void SimdFma (const double * a, double m, double b, double * out, size_t n)
+{
+  size_t  i;
+
+#ifdef SIMD_X86
+  if (GetLevel() == LEVEL_AVX2 && HasFma())
+  {
+    FmaAVX2 (a, m, b, out, n);
+    return;
+  }
+#endif
+  for (i = 0; i < n; i++) out[i] = fma (a[i], m, b);
+}
+
+
+static double Sum (const double * a, const double * b, size_t n)
+{
+#ifdef SIMD_X86
+  if (GetLevel() == LEVEL_AVX2) return SumAVX2 (a, b, n);
+  if (GetLevel() == LEVEL_SSE2) return SumSSE2 (a, b, n);
+#endif
+  return SumPlain (a, b, n);
+}
+
+
+template <int OP> static double Pick (const double * a, size_t n)
+{
+#ifdef SIMD_X86
+  if (GetLevel() == LEVEL_AVX2) return PickAVX2 <OP> (a, n);
+#endif
+  return PickPlain <OP> (a, n);
+}
+
+
+double SimdSum (const double * a, size_t n)
+{
+  return Sum (a, NULL, n);
+}
+
+
+double SimdDot (const double * a, const double * b, size_t n)
+{
+  return Sum (a, b, n);
+}
+
+
+double SimdMin (const double * a, size_t n)
+{
+  return Pick <OP_MIN> (a, n);
+}
+
+
+double SimdMax (const double * a, size_t n)
+{
+  return Pick <OP_MAX> (a, n);
+}
+
+
+const char * SimdGetLevel (void)
+{
+  if (GetLevel() == LEVEL_AVX2) return "avx2";
+  if (GetLevel() == LEVEL_SSE2) return "sse2";
+  return "plain";
+}
+
+
+// END OF FILE
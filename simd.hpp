@@ -0,0 +1,52 @@
+/*
+simd.hpp (Copyright 2003 David J. Aronson)
+Element-wise kernels over arrays of doubles, using AVX2 or SSE2 where the
+CPU has them, and plain loops where it doesn't.
+See also measurearray.*
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+
+
+// what MeasureArray (and anything else that wants SIMD-friendly buffers)
+// aligns its quantities to.  64 is a cache line, and plenty for AVX.
+#define ALIGNMENT 64
+
+
+// These all work on n doubles, and out may be the same as an input.
+// The "Scalar" ones use the same b for every element.
+void  SimdAdd (const double * a, const double * b, double * out, size_t n);
+void  SimdSub (const double * a, const double * b, double * out, size_t n);
+void  SimdMul (const double * a, const double * b, double * out, size_t n);
+void  SimdDiv (const double * a, const double * b, double * out, size_t n);
+void  SimdAddScalar (const double * a, double b, double * out, size_t n);
+void  SimdSubScalar (const double * a, double b, double * out, size_t n);
+void  SimdMulScalar (const double * a, double b, double * out, size_t n);
+void  SimdDivScalar (const double * a, double b, double * out, size_t n);
+void  SimdPower (const double * a, int pow, double * out, size_t n);
+void  SimdRoot (const double * a, int pow, double * out, size_t n);
+
+// out = a * m + b, rounded once (a fused multiply-add), so it gives just
+// what fma (a[i], m, b) does, whichever way it's done
+void  SimdFma (const double * a, double m, double b, double * out, size_t n);
+
+// Reductions.  Each keeps eight running results, lane j taking elements
+// j, j+8, j+16 and so on, then puts the lanes together in a fixed order,
+// so the answer depends only on the data, never on which instruction
+// set did the work.  Min and Max need n of at least 1.
+double  SimdSum (const double * a, size_t n);
+double  SimdDot (const double * a, const double * b, size_t n);
+double  SimdMin (const double * a, size_t n);
+double  SimdMax (const double * a, size_t n);
+
+// which instruction set the kernels above wound up using
+const char *  SimdGetLevel (void);
+
+
+#endif // ifndef SIMD_H
+
+
+// END OF FILE
@@ -0,0 +1,185 @@
+/*
+staticmeasure.hpp (Copyright 2003 David J. Aronson)
+Measures whose units are checked at COMPILE time, for inner loops.
+See also measure.*
+*/
+
+#ifndef STATICMEASURE_H
+#define STATICMEASURE_H
+
+#include <math.h>
+
+#include "measure.hpp"
+#include "unit.hpp"
+#include "unitdefs.hpp"
+
+
+// The template arguments are the powers of meter, kilogram, second, and
+// coulomb (the built-in base units; see unit.cpp).  So meters per second
+// is StaticMeasure <1, 0, -1, 0>.  A StaticMeasure is nothing but a
+// double: adding or comparing mismatched ones won't compile, and
+// multiplying or dividing works out the resulting type at compile time.
+// Convert to and from a plain Measure (explicitly!) where you need to
+// talk to code that uses those.
+template <int L, int M, int T, int Q>
+class StaticMeasure
+{
+public:
+  // Constructors
+  constexpr StaticMeasure (void) : quantity (0) { }
+  constexpr explicit StaticMeasure (double q) : quantity (q) { }
+  explicit StaticMeasure (Measure m);
+  // Member methods
+  constexpr double  GetQuantity (void) const { return quantity; }
+  explicit operator Measure (void) const { return Measure (quantity, GetUnit()); }
+  template <int P> constexpr StaticMeasure <L * P, M * P, T * P, Q * P>
+    power (void) const;
+  template <int R> StaticMeasure <L / R, M / R, T / R, Q / R>
+    root (void) const;
+  constexpr StaticMeasure  operator + (StaticMeasure m) const
+                           { return StaticMeasure (quantity + m.quantity); }
+  constexpr StaticMeasure  operator - (StaticMeasure m) const
+                           { return StaticMeasure (quantity - m.quantity); }
+  constexpr StaticMeasure  operator * (double d) const
+                           { return StaticMeasure (quantity * d); }
+  constexpr StaticMeasure  operator / (double d) const
+                           { return StaticMeasure (quantity / d); }
+  void  operator += (StaticMeasure m) { quantity += m.quantity; }
+  void  operator -= (StaticMeasure m) { quantity -= m.quantity; }
+  void  operator *= (double d) { quantity *= d; }
+  void  operator /= (double d) { quantity /= d; }
+  // overloading of + and - to add numbers purposely OMITTED, as in Measure
+  constexpr int  operator == (StaticMeasure m) const
+                 { return quantity == m.quantity; }
+  constexpr int  operator != (StaticMeasure m) const
+                 { return quantity != m.quantity; }
+  constexpr int  operator < (StaticMeasure m) const
+                 { return quantity < m.quantity; }
+  constexpr int  operator > (StaticMeasure m) const
+                 { return quantity > m.quantity; }
+  constexpr int  operator <= (StaticMeasure m) const
+                 { return quantity <= m.quantity; }
+  constexpr int  operator >= (StaticMeasure m) const
+                 { return quantity >= m.quantity; }
+  // Static methods
+  static Unit *  GetUnit (void);
+protected:
+  // Member data
+  double  quantity;
+};
+
+
+// some of the usual suspects
+typedef StaticMeasure <0, 0, 0, 0>   StaticUnitless;
+typedef StaticMeasure <1, 0, 0, 0>   StaticLength;
+typedef StaticMeasure <0, 1, 0, 0>   StaticMass;
+typedef StaticMeasure <0, 0, 1, 0>   StaticTime;
+typedef StaticMeasure <0, 0, 0, 1>   StaticCharge;
+typedef StaticMeasure <2, 0, 0, 0>   StaticArea;
+typedef StaticMeasure <1, 0, -1, 0>  StaticVelocity;
+typedef StaticMeasure <1, 0, -2, 0>  StaticAcceleration;
+typedef StaticMeasure <1, 1, -2, 0>  StaticForce;
+typedef StaticMeasure <2, 1, -2, 0>  StaticEnergy;
+typedef StaticMeasure <2, 1, -3, 0>  StaticPower;
+typedef StaticMeasure <-1, 1, -2, 0> StaticPressure;
+typedef StaticMeasure <0, 0, -1, 1>  StaticCurrent;
+typedef StaticMeasure <2, 1, -2, -1> StaticVoltage;
+typedef StaticMeasure <2, 1, -1, -2> StaticResistance;
+
+
+// multiplying and dividing StaticMeasures adds and subtracts the powers
+template <int L1, int M1, int T1, int Q1, int L2, int M2, int T2, int Q2>
+constexpr StaticMeasure <L1 + L2, M1 + M2, T1 + T2, Q1 + Q2>
+operator * (StaticMeasure <L1, M1, T1, Q1> a, StaticMeasure <L2, M2, T2, Q2> b)
+{
+  return StaticMeasure <L1 + L2, M1 + M2, T1 + T2, Q1 + Q2>
+         (a.GetQuantity() * b.GetQuantity());
+}
+
+
+template <int L1, int M1, int T1, int Q1, int L2, int M2, int T2, int Q2>
+constexpr StaticMeasure <L1 - L2, M1 - M2, T1 - T2, Q1 - Q2>
+operator / (StaticMeasure <L1, M1, T1, Q1> a, StaticMeasure <L2, M2, T2, Q2> b)
+{
+  return StaticMeasure <L1 - L2, M1 - M2, T1 - T2, Q1 - Q2>
+         (a.GetQuantity() / b.GetQuantity());
+}
+
+
+// number times StaticMeasure, e.g., 0.5 * g * t * t
+template <int L, int M, int T, int Q>
+constexpr StaticMeasure <L, M, T, Q>
+operator * (double d, StaticMeasure <L, M, T, Q> m)
+{
+  return m * d;
+}
+
+
+// number divided by StaticMeasure, e.g., 1.0 / period = frequency
+template <int L, int M, int T, int Q>
+constexpr StaticMeasure <-L, -M, -T, -Q>
+operator / (double d, StaticMeasure <L, M, T, Q> m)
+{
+  return StaticMeasure <-L, -M, -T, -Q> (d / m.GetQuantity());
+}
+
+
+// convert from a plain Measure -- which had better be in the right unit!
+// (one of no Unit yet isn't, and is refused like any other)
+template <int L, int M, int T, int Q>
+StaticMeasure <L, M, T, Q>::StaticMeasure (Measure m)
+{
+  Unit *  u = GetUnit();
+
+  if (m.GetUnitId() != u->GetId()) throw Unit::MismatchError (m.GetUnit(), u);
+  quantity = m.GetQuantity();
+}
+
+
+// raise to a power known at compile time, e.g., t.power <2> ()
+template <int L, int M, int T, int Q> template <int P>
+constexpr StaticMeasure <L * P, M * P, T * P, Q * P>
+StaticMeasure <L, M, T, Q>::power (void) const
+{
+  double  d = 1;
+  int     i;
+
+  for (i = 0; i < (P > 0 ? P : -P); i++) d *= quantity;
+  return StaticMeasure <L * P, M * P, T * P, Q * P> (P < 0 ? 1.0 / d : d);
+}
+
+
+// take a root known at compile time, e.g., area.root <2> ().
+// like Unit::root, the result must come out to whole powers.
+template <int L, int M, int T, int Q> template <int R>
+StaticMeasure <L / R, M / R, T / R, Q / R>
+StaticMeasure <L, M, T, Q>::root (void) const
+{
+  static_assert (R != 0 && L % R == 0 && M % R == 0 && T % R == 0 &&
+                 Q % R == 0, "root would give fractional powers of units");
+  if (R == 2) return StaticMeasure <L / R, M / R, T / R, Q / R>
+                     (sqrt (quantity));
+  if (R == 3) return StaticMeasure <L / R, M / R, T / R, Q / R>
+                     (cbrt (quantity));
+  return StaticMeasure <L / R, M / R, T / R, Q / R>
+         (pow (quantity, 1.0 / R));
+}
+
+
+// the (dynamic) Unit this StaticMeasure corresponds to.
+// worked out each time (the build-up cache makes that cheap), rather
+// than remembered, since it may be a temp that Unit::ReclaimTemps frees.
+template <int L, int M, int T, int Q>
+Unit * StaticMeasure <L, M, T, Q>::GetUnit (void)
+{
+  return Unit::FindUnitByBuildup
+         (Unit::FindUnitByBuildup (METER.power (L), '*', KILOGRAM.power (M)),
+          '*',
+          Unit::FindUnitByBuildup (SECOND.power (T), '*', COULOMB.power (Q)));
+}
+
+
+#endif // ifndef STATICMEASURE_H
+
+
+// END OF FILE
@@ -0,0 +1,116 @@
+/*
+stress.cpp (Copyright 2003 David J. Aronson)
+Multi-threaded stress test of the unit registry: N threads doing random
+chains of multiplies and divides, all making temp units at once.
+Usage: stress [threads [chains]]
+*/
+
+#include <iostream>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include "measure.hpp"
+#include "unit.hpp"
+#include "unitdefs.hpp"
+
+
+#define CHAINLEN 64
+#define MAXPOW   12   // keep each base unit's power within this
+
+
+// the units the chains are made of, and how they're made of the
+// base units (meter, kilogram, second, coulomb)
+struct Ingredient
+{
+  Unit *  unit;
+  int     pow[4];
+};
+
+Ingredient  ingredients[] =
+{
+  { &METER,    { 1, 0, 0, 0 } },
+  { &KILOGRAM, { 0, 1, 0, 0 } },
+  { &SECOND,   { 0, 0, 1, 0 } },
+  { &COULOMB,  { 0, 0, 0, 1 } },
+  { &MpS,      { 1, 0, -1, 0 } },
+  { &NEWTON,   { 1, 1, -2, 0 } },
+  { &JOULE,    { 2, 1, -2, 0 } },
+  { &VOLT,     { 2, 1, -2, -1 } },
+};
+const int  nIngredients = sizeof (ingredients) / sizeof (ingredients[0]);
+
+
+// what a chain should have come out to, by going about it differently
+Unit * Expected (int * pow)
+{
+  return (Measure (1, METER.power (pow[0])) *
+          Measure (1, KILOGRAM.power (pow[1])) *
+          Measure (1, SECOND.power (pow[2])) *
+          Measure (1, COULOMB.power (pow[3]))).GetUnit();
+}
+
+
+// one thread's worth: random chains, each checked at the end.
+// also checks that equal units are the very same Unit, i.e., that no
+// two threads ever made separate temps for the same dimension.
+void Worker (unsigned seed, int chains, int * failures)
+{
+  int  c;
+
+  for (c = 0; c < chains; c++)
+  {
+    int      pow[4] = { 0, 0, 0, 0 };
+    Unit *   u = &Unit::UNITLESS;
+    int      i;
+
+    for (i = 0; i < CHAINLEN; i++)
+    {
+      Ingredient *  g = &ingredients[rand_r (&seed) % nIngredients];
+      int           sign = (rand_r (&seed) & 1) ? 1 : -1;
+      int           j;
+      int           tooFar = 0;
+
+      // turn around rather than go past MAXPOW
+      for (j = 0; j < 4; j++)
+      {
+        int  p = pow[j] + sign * g->pow[j];
+        if (p > MAXPOW || p < -MAXPOW) tooFar = 1;
+      }
+      if (tooFar) sign = -sign;
+      for (j = 0; j < 4; j++) pow[j] += sign * g->pow[j];
+      u = Unit::FindUnitByBuildup (u, (sign > 0) ? '*' : '/', g->unit);
+    }
+    if (u != Expected (pow)) (*failures)++;
+  }
+}
+
+
+int main (int argc, char * argv[])
+{
+  int                nThreads = thread::hardware_concurrency();
+  int                chains = 20000;
+  vector <thread>    threads;
+  vector <int>       failures;
+  int                total = 0;
+  int                i;
+
+  if (argc > 1) nThreads = atoi (argv[1]);
+  if (argc > 2) chains = atoi (argv[2]);
+  if (nThreads < 1) nThreads = 1;
+  failures.resize (nThreads, 0);
+  for (i = 0; i < nThreads; i++)
+  {
+    threads.push_back (thread (Worker, 12345 + i, chains, &failures[i]));
+  }
+  for (i = 0; i < nThreads; i++)
+  {
+    threads[i].join();
+    total += failures[i];
+  }
+  cout << nThreads << " threads x " << chains << " chains of " << CHAINLEN
+       << ": " << total << " failures" << endl;
+  return total != 0;
+}
+
+
+// END OF FILE
@@ -1,13 +1,1162 @@
 #include <iostream>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include "affine.hpp"
+#include "conversion.hpp"
+#include "formula.hpp"
+#include "measurearray.hpp"
+#include "measureexpr.hpp"
+#include "measurefile.hpp"
+#include "quantitystream.hpp"
+#include "reduction.hpp"
+#include "staticmeasure.hpp"
+#include "trajectory.hpp"
+#include "unitparser.hpp"
 #include "unit.hpp"
 #include "measure.hpp"
 #include "unitdefs.hpp"
 #include "measuredefs.hpp"
 
+
+int  failures = 0;
+
+
+// complain (to cerr, so the breakdowns stay clean) if a check is false
+void Check (int ok, const char * what)
+{
+  if (! ok)
+  {
+    cerr << "FAILED: " << what << endl;
+    failures++;
+  }
+}
+
+
+// what JOULE was while this file's statics were being made, which
+// (link order or not) may be before anything in unit.cpp has run
+Dimension  staticJoule = JOULE.GetDimension();
+
+
+// the standard catalogue: all there, all findable, from the start
+void TestCatalogue (void)
+{
+  Dimension  d;
+
+  METER.GetDimension().Buildup ('*', NEWTON.GetDimension(), &d);
+  Check (staticJoule == d && JOULE.GetDimension() == d,
+         "catalogue made before any static initializer runs");
+  Check (Unit::FindUnitByName ("inch") == &INCH &&
+         Unit::FindUnitByName ("mile") == &MILE &&
+         Unit::FindUnitByName ("fpsps") == &FPSPS, "catalogue by name");
+  Check (Unit::FindUnitByName ("slugs per kilogram") == &SLUGSPERKILOGRAM &&
+         SLUGSPERKILOGRAM.GetName() == "slugs per kilogram",
+         "a catalogue name longer than a short string");
+  Check (Unit::FindUnitByDimension (d) == &JOULE &&
+         Unit::FindUnitByDimension (Dimension()) == &Unit::UNITLESS,
+         "catalogue by dimension");
+  Check (INCH != FOOT && YARD != FOOT && MILE != INCH,
+         "inch, yard, and mile are base units of their own");
+  Check (Unit::GetBaseUnit (0) == &SECOND && Unit::GetBaseUnit (8) == &MILE,
+         "catalogue base unit slots");
+  Check (*Unit::FindUnitByBuildup (&FOOT, '*', &POUND) == FOOTPOUND,
+         "catalogue build-ups");
+}
+
+
+// Dimensions by themselves: right up to MAXEXPONENT either way, and not
+// a step past it; and a failed one leaves the result alone
+void TestDimensions (void)
+{
+  Dimension  base = Dimension::Base (0);
+  Dimension  top;
+  Dimension  bottom;
+  Dimension  d;
+  Dimension  r;
+
+  Check (base.Power (MAXEXPONENT, &top) &&
+         top.GetExponent (0) == MAXEXPONENT && top.GetExponent (1) == 0,
+         "Power to MAXEXPONENT");
+  Check (base.Power (-MAXEXPONENT, &bottom) &&
+         bottom.GetExponent (0) == -MAXEXPONENT, "Power to -MAXEXPONENT");
+  r = base;
+  Check (! base.Power (MAXEXPONENT + 1, &r) &&
+         ! base.Power (-MAXEXPONENT - 1, &r) && r == base,
+         "Power past MAXEXPONENT");
+  Dimension::Base (1).Power (2, &d);
+  Check (d.Power (MAXEXPONENT / 2, &r) &&
+         r.GetExponent (1) == MAXEXPONENT - 1 &&
+         ! d.Power (MAXEXPONENT / 2 + 1, &r) &&
+         ! d.Power (-MAXEXPONENT / 2 - 1, &r), "Power of a square");
+  Check (Dimension().Power (MAXEXPONENT + 1, &r) && r.IsUnitless() &&
+         Dimension().Power (-2147483647 - 1, &r) && r.IsUnitless(),
+         "unitless to any Power");
+
+  Check (top.Buildup ('/', base, &d) && d.GetExponent (0) == MAXEXPONENT - 1 &&
+         d.Buildup ('*', base, &r) && r == top, "Buildup up to MAXEXPONENT");
+  Check (bottom.Buildup ('*', base, &d) &&
+         d.GetExponent (0) == 1 - MAXEXPONENT &&
+         d.Buildup ('/', base, &r) && r == bottom,
+         "Buildup down to -MAXEXPONENT");
+  r = base;
+  Check (! top.Buildup ('*', base, &r) && ! bottom.Buildup ('/', base, &r) &&
+         ! top.Buildup ('/', bottom, &r) && r == base,
+         "Buildup past MAXEXPONENT");
+  Check (top.Buildup ('*', bottom, &r) && r.IsUnitless(),
+         "MAXEXPONENT and -MAXEXPONENT cancel");
+
+  Check (top.Root (MAXEXPONENT, &r) && r == base &&
+         bottom.Root (-MAXEXPONENT, &r) && r == base, "Root of MAXEXPONENT");
+  base.Power (3, &d);
+  d.Buildup ('*', Dimension::Base (1), &d);
+  r = base;
+  Check (! d.Root (2, &r) && ! d.Root (3, &r) && ! d.Root (0, &r) &&
+         r == base, "Root that doesn't divide every exponent");
+  Check (top.Root (-1, &r) && r == bottom, "Root -1");
+}
+
+
+// powers and roots of Measures, including the overflow checks
+void TestPowersAndRoots (void)
+{
+  Measure       m = Measure (2, &METER);
+  Measure       s = Measure (3, &SECOND);
+  int           thrown;
+  double        neg[5] = { -8, -27, -0.125, 64, -1 };
+  double        signs[5] = { 1, -1, 1, -1, -1 };
+  MeasureArray  a (METER.power (3), neg, 5);
+  MeasureArray  b (&Unit::UNITLESS, signs, 5);
+  MeasureArray  r;
+  MeasureArray  p;
+  int           ok;
+  size_t        i;
+
+  Check (m.power (10).GetQuantity() == 1024, "2 m to the 10th");
+  Check (*m.power (10).GetUnit() == *METER.power (10), "unit of m^10");
+  Check (m.power (-3).GetQuantity() == 0.125, "2 m to the -3rd");
+  Check (*m.power (0).GetUnit() == Unit::UNITLESS, "m^0 is unitless");
+  Check (s.power (2).sqrt().GetQuantity() == 3, "sqrt of 9 s^2");
+  Check (fabs (s.power (3).cbrt().GetQuantity() - 3) < 1e-12,
+         "cbrt of 27 s^3");
+  Check (s.power (2).root (-2).GetQuantity() == 1.0 / 3, "root -2 of 9 s^2");
+  Check (*s.power (2).root (-2).GetUnit() == *SECOND.power (-1),
+         "unit of root -2 of s^2");
+  Check (fabs (m.power (4).root (4).GetQuantity() - 2) < 1e-12,
+         "4th root of 16 m^4");
+
+  // the most a base unit can go to is the 127th power, either way
+  Check (METER.power (127) != NULL, "m^127 is allowed");
+  Check (METER.power (-127) != NULL, "m^-127 is allowed");
+  thrown = 0;
+  try { METER.power (128); }
+  catch (Unit::OverflowError) { thrown = 1; }
+  Check (thrown, "m^128 overflows");
+  thrown = 0;
+  try { NEWTON.power (64); }   // kg m / s^2 -- the s^2 gets to 128
+  catch (Unit::OverflowError) { thrown = 1; }
+  Check (thrown, "N^64 overflows");
+  thrown = 0;
+  try { Measure (1, METER.power (100)) * Measure (1, METER.power (100)); }
+  catch (Unit::OverflowError) { thrown = 1; }
+  Check (thrown, "m^100 * m^100 overflows");
+  thrown = 0;
+  try { m.power (1 << 30); }
+  catch (Unit::OverflowError) { thrown = 1; }
+  Check (thrown, "m^(2^30) overflows");
+  thrown = 0;
+  try { m.power (-2147483647 - 1); }
+  catch (Unit::OverflowError) { thrown = 1; }
+  Check (thrown, "m^INT_MIN overflows");
+  Check (Measure (2, &Unit::UNITLESS).power (1000).GetUnit()
+         == &Unit::UNITLESS, "unitless to any power is unitless");
+
+  // roots that would give fractional powers
+  thrown = 0;
+  try { m.power (3).sqrt(); }
+  catch (Unit::BadRootError) { thrown = 1; }
+  Check (thrown, "sqrt of m^3 is no good");
+  thrown = 0;
+  try { m.root (0); }
+  catch (Unit::BadRootError) { thrown = 1; }
+  Check (thrown, "0th root is no good");
+
+  // a whole array gives what its Measures would one at a time, negative
+  // quantities (and the most negative power) included
+  r = a.root (-3);
+  ok = (r.GetUnit() == a.Get (0).root (-3).GetUnit());
+  for (i = 0; i < 5; i++)
+  {
+    ok &= (r.GetQuantities()[i] == a.Get (i).root (-3).GetQuantity());
+  }
+  Check (ok, "array root -3 of negatives, as Measures");
+  p = b.power (-2147483647 - 1);
+  ok = 1;
+  for (i = 0; i < 5; i++)
+  {
+    ok &= (p.GetQuantities()[i] ==
+           b.Get (i).power (-2147483647 - 1).GetQuantity());
+  }
+  Check (ok, "unitless array to the INT_MIN, as Measures");
+}
+
+
+// the conversion engine, on the built-in factors
+void TestConversions (void)
+{
+  Measure  tenMeters = Measure (10, &METER);
+  double   fpm = CONVERT_FEETPERMETER.GetQuantity();
+  int      thrown;
+
+  Check (Conversion::Convert (tenMeters, &FOOT).GetQuantity() == 10 * fpm,
+         "meters to feet");
+  Check (fabs (Conversion::Convert (Measure (10 * fpm, &FOOT), &METER)
+               .GetQuantity() - 10) < 1e-12, "feet to meters");
+  Check (Conversion::Convert (tenMeters, &METER).GetQuantity() == 10,
+         "meters to meters");
+  // derived units, through the base units
+  Check (fabs (Conversion::Convert (Measure (10, &MpS), Unit::FindUnitByName
+                                    ("fps")).GetQuantity() - 10 * fpm)
+         < 1e-12, "m/s to fps");
+  Check (fabs (Conversion::FindFactor (&M2, FOOT.power (2)) - fpm * fpm)
+         < 1e-12, "square meters to square feet");
+  Check (fabs (Conversion::FindFactor (&JOULE, &FOOTPOUND) *
+               Conversion::FindFactor (&FOOTPOUND, &JOULE) - 1) < 1e-12,
+         "joules to foot-pounds and back");
+  // a factor between two derived units is used directly (and Convert
+  // must forget the factor it had cached before)
+  Conversion::Convert (Measure (2, &JOULE), &FOOTPOUND);
+  Conversion::AddFactor (&JOULE, &FOOTPOUND, 0.7375621);
+  Check (Conversion::FindFactor (&JOULE, &FOOTPOUND) == 0.7375621,
+         "direct factor beats decomposing");
+  Check (Conversion::Convert (Measure (2, &JOULE), &FOOTPOUND).GetQuantity()
+         == 2 * 0.7375621, "Convert uses the new factor");
+  // inches, yards and miles, through feet
+  Check (fabs (Conversion::Convert (Measure (24, &INCH), &FOOT).GetQuantity()
+               - 2) < 1e-12 &&
+         fabs (Conversion::Convert (Measure (2, &FOOT), &INCH).GetQuantity()
+               - 24) < 1e-12, "inches to feet and back");
+  Check (fabs (Conversion::Convert (Measure (12, &INCH), &METER)
+               .GetQuantity() - 1 / fpm) < 1e-12 &&
+         fabs (Conversion::Convert (Measure (1 / fpm, &METER), &INCH)
+               .GetQuantity() - 12) < 1e-12, "inches to meters and back");
+  Check (fabs (Conversion::Convert (Measure (1, &MILE), &YARD).GetQuantity()
+               - 1760) < 1e-9, "miles to yards");
+  thrown = 0;
+  try { Conversion::Convert (tenMeters, &SECOND); }
+  catch (Conversion::NoPathError) { thrown = 1; }
+  Check (thrown, "meters to seconds has no path");
+  thrown = 0;
+  try { Conversion (&METER, &FOOT).Apply (Measure (1, &SECOND)); }
+  catch (Unit::MismatchError) { thrown = 1; }
+  Check (thrown, "applying meters-to-feet to seconds");
+  thrown = 0;
+  {
+    MeasureArray  secs (&SECOND, 3);
+    MeasureArray  none;
+
+    try { Conversion (&METER, &FOOT).Apply (secs); }
+    catch (Unit::MismatchError) { thrown++; }
+    try { Conversion (&METER, &FOOT).Apply (none); }
+    catch (Unit::MismatchError) { thrown++; }
+    try { Conversion (&METER, &FOOT).Apply (Measure()); }
+    catch (Unit::MismatchError) { thrown++; }
+  }
+  Check (thrown == 3, "applying to the wrong Unit, or none");
+}
+
+
+// affine units: absolutes and deltas kept apart, and conversions that
+// give the same answers one at a time as a buffer at a time
+void TestAffine (void)
+{
+  AffineConversion  cToF (&CELSIUS, &FAHRENHEIT);
+  AffineMeasure     room = AffineMeasure (20, &CELSIUS);
+  double            in[1001];
+  double            out[1001];
+  int               same;
+  int               thrown;
+  int               i;
+
+  Check (fabs (cToF.Apply (100) - 212) < 1e-12 &&
+         fabs (cToF.Apply (-40) + 40) < 1e-12, "celsius to fahrenheit");
+  Check (fabs (AffineMeasure (32, &FAHRENHEIT).In (&CELSIUS).GetQuantity())
+         < 1e-12, "fahrenheit to celsius");
+  Check (*room.ToMeasure().GetUnit() == KELVIN &&
+         fabs (room.ToMeasure().GetQuantity() - 293.15) < 1e-12,
+         "celsius to kelvin");
+  Check (fabs (AffineConversion (&KELVIN, &CELSIUS).FromMeasure
+               (Measure (273.15, &KELVIN)).GetQuantity()) < 1e-12,
+         "kelvin to celsius");
+  Check (AffineMeasure (0, &GAUGEPASCAL).ToMeasure().GetQuantity() == 101325,
+         "gauge pressure");
+  // absolute - absolute is a delta, absolute + delta an absolute
+  Check (*(AffineMeasure (30, &CELSIUS) - room).GetUnit() == KELVIN &&
+         fabs ((AffineMeasure (30, &CELSIUS) - room).GetQuantity() - 10)
+         < 1e-12, "difference of two temperatures");
+  Check (fabs ((AffineMeasure (212, &FAHRENHEIT) -
+                AffineMeasure (100, &CELSIUS)).GetQuantity()) < 1e-12,
+         "difference across affine units");
+  Check (fabs ((room + FAHRENHEIT.Delta (9)).GetQuantity() - 25) < 1e-12,
+         "temperature plus a delta");
+  Check (AffineMeasure (0, &CELSIUS) > AffineMeasure (0, &FAHRENHEIT) &&
+         AffineMeasure (100, &CELSIUS) < AffineMeasure (212.001, &FAHRENHEIT),
+         "comparing across affine units");
+  thrown = 0;
+  try { room + Measure (1, &METER); }
+  catch (Unit::MismatchError) { thrown = 1; }
+  Check (thrown, "adding meters to a temperature");
+  thrown = 0;
+  try { cToF.Apply (AffineMeasure (1, &FAHRENHEIT)); }
+  catch (AffineUnit::MismatchError) { thrown = 1; }
+  Check (thrown, "applying celsius-to-fahrenheit to fahrenheit");
+  // (an odd size, so the vector loop leaves some over)
+  for (i = 0; i < 1001; i++) in[i] = (i - 500) * 0.37;
+  cToF.Apply (in, out, 1001);
+  same = 1;
+  for (i = 0; i < 1001; i++) same = same && out[i] == cToF.Apply (in[i]);
+  Check (same, "bulk affine conversion matches one at a time");
+}
+
+
+// parallel reductions: the right answers and Units, and sums that come
+// out the same to the last bit however many threads do them
+void TestReductions (void)
+{
+  const size_t  n = 100003;   // (not a whole number of blocks or lanes)
+  MeasureArray  dist (&METER, n);
+  MeasureArray  force (&NEWTON, n);
+  MeasureArray  none (&METER, 0);
+  Measure *     each = new Measure[n];
+  Measure       mixed[3] = { Measure (1, &METER), Measure (2, &METER),
+                             Measure (1, &SECOND) };
+  ThreadPool    one (1);
+  ThreadPool    three (3);
+  ThreadPool    eight (8);
+  long double   exact = 0;
+  double        least = 0;
+  double        most = 0;
+  Measure       sum;
+  int           thrown;
+  size_t        i;
+
+  for (i = 0; i < n; i++)
+  {
+    dist.GetQuantities()[i] = sin (i * 0.01) * 1000 + (i % 7) * 1e-9;
+    force.GetQuantities()[i] = 2;
+    each[i] = Measure (dist.GetQuantities()[i], &METER);
+    exact += dist.GetQuantities()[i];
+    least = fmin (least, dist.GetQuantities()[i]);
+    most = fmax (most, dist.GetQuantities()[i]);
+  }
+  sum = Reduction::Sum (dist, &one);
+  Check (*sum.GetUnit() == METER && fabs (sum.GetQuantity() - exact) < 1e-8,
+         "sum of an array");
+  Check (Reduction::Sum (dist, &three).GetQuantity() == sum.GetQuantity() &&
+         Reduction::Sum (dist, &eight).GetQuantity() == sum.GetQuantity() &&
+         Reduction::Sum (dist).GetQuantity() == sum.GetQuantity(),
+         "sums are the same on any number of threads");
+  Check (Reduction::Sum (each, n, &three).GetQuantity() == sum.GetQuantity(),
+         "sum of Measures one by one is the sum of the array");
+  Check (Reduction::Mean (dist, &three).GetQuantity() == sum.GetQuantity() / n,
+         "mean");
+  Check (Reduction::Min (dist, &three).GetQuantity() == least &&
+         Reduction::Min (each, n, &eight).GetQuantity() == least, "min");
+  Check (Reduction::Max (dist, &one).GetQuantity() == most &&
+         Reduction::Max (each, n, &eight).GetQuantity() == most, "max");
+  Check (*Reduction::Dot (dist, force, &three).GetUnit() == JOULE &&
+         Reduction::Dot (dist, force, &three).GetQuantity() ==
+         2 * sum.GetQuantity(), "meters dot newtons is joules");
+  Check (*Reduction::Norm (force, &eight).GetUnit() == NEWTON &&
+         fabs (Reduction::Norm (force, &eight).GetQuantity() -
+               2 * ::sqrt ((double) n)) < 1e-9, "norm");
+  Check (Reduction::Sum (none).GetQuantity() == 0, "sum of nothing");
+  thrown = 0;
+  try { Reduction::Mean (each, 0); }
+  catch (Reduction::EmptyError) { thrown = 1; }
+  Check (thrown, "mean of nothing");
+  thrown = 0;
+  try { Reduction::Sum (mixed, 3, &three); }
+  catch (Unit::MismatchError) { thrown = 1; }
+  Check (thrown, "summing meters and a second");
+  delete [] each;
+}
+
+
+// formulas, compiled once and evaluated on numbers, Measures and arrays
+void TestFormulas (void)
+{
+  Formula       f ("sqrt (2*d/G)");
+  Formula       g ("-x^2 + 3*x - 2/x - (1 - x)");
+  Measure       h = Measure (10, &METER);
+  double        d = 10;
+  double        xs[5] = { 0.5, 1, 2, 3, -4 };
+  MeasureArray  a (&METER, xs, 5);
+  MeasureArray  r;
+  int           i;
+  int           thrown;
+
+  f.BindConstant ("G", G);
+  f.BindVariable ("d", &METER);
+  f.Compile();
+  Check (*f.GetUnit() == SECOND, "sqrt (2d/G) is in seconds");
+  Check (f.Evaluate (&d) == sqrt (2 * 10 / G.GetQuantity()),
+         "sqrt (2d/G) on a number");
+  Check (f.Evaluate (&h).GetQuantity() == f.Evaluate (&d),
+         "sqrt (2d/G) on a Measure");
+  g.BindVariable ("x", &Unit::UNITLESS);
+  g.Compile();
+  Check (g.Evaluate (&xs[3]) == -9 + 9 - 2.0 / 3 - (1 - 3.0), "polynomial");
+  {
+    MeasureArray  ua (&Unit::UNITLESS, xs, 5);
+    r = g.Evaluate (&ua);
+    for (i = 0; i < 5; i++)
+    {
+      Check (r.GetQuantities()[i] == g.Evaluate (&xs[i]),
+             "batch matches one at a time");
+    }
+  }
+  {
+    MeasureArray  t = f.Evaluate (&a);
+    Check (*t.GetUnit() == SECOND && t.GetQuantities()[2] ==
+           f.Evaluate (&xs[2]), "batch sqrt (2d/G)");
+  }
+
+  thrown = 0;
+  try { Measure s = Measure (1, &SECOND); f.Evaluate (&s); }
+  catch (Unit::MismatchError) { thrown = 1; }
+  Check (thrown, "formula given seconds for meters");
+  thrown = 0;
+  try
+  {
+    Formula  bad ("d + G");
+    bad.BindConstant ("G", G);
+    bad.BindVariable ("d", &METER);
+    bad.Compile();
+  }
+  catch (Unit::MismatchError) { thrown = 1; }
+  Check (thrown, "meters plus m/s^2 doesn't compile");
+  thrown = 0;
+  try
+  {
+    Formula  bad ("2 * (d + ");
+    bad.BindVariable ("d", &METER);
+    bad.Compile();
+  }
+  catch (Formula::ParseError) { thrown = 1; }
+  Check (thrown, "unfinished formula doesn't parse");
+  thrown = 0;
+  try { Formula ("sqrt (q)").Compile(); }
+  catch (Formula::ParseError e) { thrown = (e.pos == 6); }
+  Check (thrown, "unknown name, and where");
+  thrown = 0;
+  try
+  {
+    Formula  bad ("d^4294967297");
+    bad.BindVariable ("d", &METER);
+    bad.Compile();
+  }
+  catch (Formula::ParseError e) { thrown = (e.pos == 2); }
+  Check (thrown, "power past an int isn't d^1");
+}
+
+
+// unit strings, and the cache of them
+void TestUnitStrings (void)
+{
+  Unit *  u;
+  ulong   hits;
+  ulong   misses;
+  ulong   hits2;
+  ulong   misses2;
+  int     thrown;
+
+  Check (UnitParser::Parse ("kg*m/s^2") == &NEWTON, "kg*m/s^2 is newtons");
+  Check (UnitParser::Parse ("kg * m / s ^ 2") == &NEWTON, "with spaces");
+  Check (UnitParser::Parse ("foot-pound") == &FOOTPOUND, "foot-pound");
+  Check (UnitParser::Parse ("ft*lbf") == &FOOTPOUND, "ft*lbf");
+  Check (UnitParser::Parse ("m/s^2") == &MpSpS, "a name with / and ^ in it");
+  Check (UnitParser::Parse ("N*m") == &JOULE, "N*m is joules");
+  Check (UnitParser::Parse ("ft/(s*s)") ==
+         Unit::FindUnitByName ("fpsps"), "parentheses");
+  Check (UnitParser::Parse ("1/s") == UnitParser::Parse ("s^-1"),
+         "1/s is s^-1");
+  Check (UnitParser::Parse ("1/s") != &SECOND, "1/s isn't seconds");
+  Check (UnitParser::Parse ("m/m") == &Unit::UNITLESS, "m/m is unitless");
+
+  // seen before is a hit, until an alias is added
+  UnitParser::Parse ("kg*m^2/s^3");
+  UnitParser::GetCacheStats (&hits, &misses);
+  Check (UnitParser::Parse ("kg*m^2/s^3") == &WATT, "kg*m^2/s^3 is watts");
+  UnitParser::GetCacheStats (&hits2, &misses2);
+  Check (hits2 == hits + 1 && misses2 == misses, "second parse is a hit");
+  UnitParser::AddAlias ("slugs", &SLUG);
+  UnitParser::Parse ("kg*m^2/s^3");
+  UnitParser::GetCacheStats (&hits, &misses);
+  Check (hits == hits2 && misses == misses2 + 1, "AddAlias empties cache");
+  Check (UnitParser::Parse ("slugs*fpsps") == &POUND, "a new alias");
+
+  // a temp Unit that's been reclaimed mustn't come back from the cache
+  u = UnitParser::Parse ("kg*m^3");
+  Check (UnitParser::Parse ("kg*m^3") == u, "temp unit cached");
+  Unit::ReclaimTemps();
+  UnitParser::GetCacheStats (&hits2, &misses2);
+  u = UnitParser::Parse ("kg*m^3");
+  UnitParser::GetCacheStats (&hits, &misses);
+  Check (misses == misses2 + 1, "ReclaimTemps empties cache");
+  Check (u->GetDimension() ==
+         Unit::FindUnitByBuildup (&KILOGRAM, '*', METER.power (3))
+         ->GetDimension(), "kg*m^3 again after ReclaimTemps");
+
+  thrown = 0;
+  try { UnitParser::Parse ("kg*furlong"); }
+  catch (UnitParser::ParseError e) { thrown = (e.pos == 3); }
+  Check (thrown, "unknown unit name, and where");
+  thrown = 0;
+  try { UnitParser::Parse ("(m/s"); }
+  catch (UnitParser::ParseError) { thrown = 1; }
+  Check (thrown, "missing )");
+  thrown = 0;
+  try { UnitParser::Parse ("m^x"); }
+  catch (UnitParser::ParseError) { thrown = 1; }
+  Check (thrown, "non-numeric power");
+  thrown = 0;
+  try { UnitParser::Parse ("m^4294967297"); }
+  catch (UnitParser::ParseError e) { thrown = (e.pos == 2); }
+  Check (thrown, "power past an int isn't m^1");
+  thrown = 0;
+  try { UnitParser::Parse ("m^-4294967294"); }
+  catch (UnitParser::ParseError) { thrown = 1; }
+  Check (thrown, "power past an int isn't m^2");
+  thrown = 0;
+  try { UnitParser::Parse ("m^99999999999999999999"); }
+  catch (UnitParser::ParseError) { thrown = 1; }
+  Check (thrown, "power past a long");
+  thrown = 0;
+  try { UnitParser::Parse ("m s"); }
+  catch (UnitParser::ParseError) { thrown = 1; }
+  Check (thrown, "two names with no operator");
+  thrown = 0;
+  try { UnitParser::Parse (string ("m\0*s", 4)); }
+  catch (UnitParser::ParseError e) { thrown = (e.pos == 0); }
+  Check (thrown, "a NUL in a name");
+  thrown = 0;
+  try { UnitParser::Parse (string ("m*\0", 3)); }
+  catch (UnitParser::ParseError e)
+  {
+    thrown = (e.pos == 2 && e.problem == "unknown unit name");
+  }
+  Check (thrown, "a NUL for a name");
+}
+
+
+// writing Measures to a file and mapping them back in
+void TestMeasureFiles (void)
+{
+  char          path[] = "/tmp/measuretestXXXXXX";
+  double        xs[5] = { 1, 2, 3, 4, 5 };
+  MeasureArray  a (&MpS, xs, 5);
+  Unit *        odd = METER.power (5);  // (a temp)
+  int           i;
+  int           ok;
+  int           thrown;
+  FILE *        f;
+  Measure       end;
+
+  close (mkstemp (path));
+  {
+    MeasureWriter  w (path);
+    w.Write (Measure (1.5, &METER));
+    w.Write (Measure (2.5, &SECOND));
+    w.Write (a);
+    for (i = 0; i < RECORDBLOCKSIZE + 10; i++) w.Write (Measure (i, odd));
+    w.Close();
+  }
+  {
+    MeasureReader  r (path);
+    MeasureView    v;
+    Measure        m1 = r.Next();
+    Measure        m2 = r.Next();
+    Unit *         u = NULL;
+
+    Check (r.GetSize() == 7 + RECORDBLOCKSIZE + 10, "file has every Measure");
+    Check (m1.GetQuantity() == 1.5 && m1.GetUnit() == &METER, "first record");
+    Check (m2.GetQuantity() == 2.5 && m2.GetUnit() == &SECOND,
+           "second record");
+    Check (r.GetBlockCount() == 4 && r.IsColumn (1) && ! r.IsColumn (2),
+           "records, column, records");
+    v = r.GetColumn (1);
+    Check (v.GetUnit() == &MpS && v.GetSize() == 5 &&
+           v.GetQuantities()[4] == 5, "column read back");
+    Check ((uintptr_t) v.GetQuantities() % ALIGNMENT == 0, "column aligned");
+    Check (v.ToArray().GetQuantities()[2] == 3, "column to MeasureArray");
+    ok = 1;
+    for (i = 0; i < 5; i++) ok &= (r.Next().GetQuantity() == xs[i]);
+    Check (ok, "Next goes through the column");
+    for (i = 0; ! r.AtEnd(); i++)
+    {
+      Measure  m = r.Next();
+      ok &= (m.GetQuantity() == i);
+      u = m.GetUnit();
+    }
+    Check (ok && i == RECORDBLOCKSIZE + 10 && u == odd,
+           "records in a temp unit, across blocks");
+    end = r.Next();
+  }
+  // a Measure of no Unit yet (as Next gives at the end) goes in as
+  // unitless, so what a reader gives back can be written again
+  {
+    MeasureWriter  w (path);
+
+    w.Write (Measure (3, &Unit::UNITLESS));
+    w.Write (Measure());
+    w.Write (end);
+    w.Close();
+  }
+  {
+    MeasureReader  r (path);
+    Measure        m1 = r.Next();
+    Measure        m2 = r.Next();
+    Measure        m3 = r.Next();
+
+    Check (r.GetSize() == 3 && m1.GetQuantity() == 3 &&
+           m1.GetUnit() == &Unit::UNITLESS &&
+           m2.GetUnit() == &Unit::UNITLESS && m2.GetQuantity() == 0 &&
+           m3.GetUnit() == &Unit::UNITLESS, "a Measure of no Unit");
+  }
+
+  thrown = 0;
+  f = fopen (path, "wb");
+  fputs ("not measures at all", f);
+  fclose (f);
+  try { MeasureReader  r (path); }
+  catch (MeasureFile::FormatError) { thrown = 1; }
+  Check (thrown, "garbage file refused");
+  unlink (path);
+  thrown = 0;
+  try { MeasureReader  r (path); }
+  catch (MeasureFile::IOError) { thrown = 1; }
+  Check (thrown, "missing file");
+}
+
+
+// run text through StreamQuantities (with nothing done to the numbers),
+// giving back what it wrote
+int StreamText (const string & text, int allowNegative, string * out,
+                string * bad)
+{
+  FILE *  in = tmpfile();
+  FILE *  o = tmpfile();
+  int     ok;
+  int     c;
+
+  fwrite (text.data(), 1, text.size(), in);
+  rewind (in);
+  ok = StreamQuantities (in, o, &METER,
+                         [] (MeasureArray & a) { return a; },
+                         allowNegative, bad);
+  rewind (o);
+  *out = "";
+  while ((c = getc (o)) != EOF) *out += (char) c;
+  fclose (in);
+  fclose (o);
+  return ok;
+}
+
+
+// the batch modes' reader: numbers cut off by the end of a buffer, no
+// newline at the end, DOS line ends, and fields that aren't numbers
+void TestQuantityStreams (void)
+{
+  string  text;
+  string  want;
+  string  out;
+  string  bad;
+  int     i;
+
+  // (well over one INBUFSIZE, so numbers straddle the reads; the halves
+  // keep the shortest form from turning 700000 into 7e+05)
+  for (i = 0; text.size() < INBUFSIZE * 5 / 2; i++)
+  {
+    text += to_string (i * 7) + ".5" + ((i % 3 == 0) ? "\r\n" :
+                                        (i % 3 == 1) ? ", " : ";\t");
+    want += to_string (i * 7) + ".5\n";
+  }
+  Check (StreamText (text, 0, &out, &bad) && out == want,
+         "quantities across buffer boundaries");
+  Check (StreamText ("1.5 2\r\n3", 0, &out, &bad) && out == "1.5\n2\n3\n",
+         "no newline at the end");
+  Check (StreamText ("1\r\n\r\n+2\r\n", 0, &out, &bad) && out == "1\n2\n",
+         "DOS line ends");
+  Check (! StreamText ("1 x 3\n", 0, &out, &bad) && bad == "x" &&
+         out == "1\n", "a field that isn't a number");
+  Check (! StreamText ("1 2.5q\n", 0, &out, &bad) && bad == "2.5q",
+         "a number with junk after it");
+  Check (! StreamText ("+-5\n", 1, &out, &bad) && bad == "+-5" &&
+         ! StreamText ("++5\n", 1, &out, &bad) &&
+         ! StreamText ("1 +\n", 1, &out, &bad),
+         "two signs, or one alone");
+  Check (! StreamText ("-5\n", 0, &out, &bad) && bad == "-5" &&
+         StreamText ("-5\n", 1, &out, &bad) && out == "-5\n",
+         "negatives, only when allowed");
+  Check (! StreamText (string ("1\0" "2\n", 4), 0, &out, &bad) &&
+         bad == string ("1\0" "2", 3), "a NUL is no separator");
+}
+
+
+// a hook for TestStats
+int  hookCalls = 0;
+void CountHookCalls (StatsEvent e, double ns)
+{
+  if (e == STATS_BUILDUP && ns >= 0) hookCalls++;
+}
+
+
+// the hot-path counters, which are only there with MEASURE_STATS
+void TestStats (void)
+{
+  UnitStats  before = Unit::GetStats();
+  UnitStats  after;
+  Measure    a = Measure (1, &METER);
+  Measure    b = Measure (2, &METER);
+  Measure    t = Measure (3, &SECOND);
+  Measure    c;
+  int        i;
+
+  c = a + b;
+  c = a - b;
+  a * t;
+  a / t;
+  try { a + t; }
+  catch (Unit::MismatchError) { }
+  Unit::SetStatsHook (CountHookCalls, 2);
+  for (i = 0; i < 10; i++) a * t;
+  Unit::SetStatsHook (NULL, 1);
+  after = Unit::GetStats();
+#ifdef MEASURE_STATS
+  Check (after.enabled, "stats enabled");
+  Check (after.count[STATS_ADDS] - before.count[STATS_ADDS] == 2 &&
+         after.count[STATS_SUBS] - before.count[STATS_SUBS] == 1 &&
+         after.count[STATS_MULS] - before.count[STATS_MULS] == 11 &&
+         after.count[STATS_DIVS] - before.count[STATS_DIVS] == 1 &&
+         after.count[STATS_ASSIGNS] - before.count[STATS_ASSIGNS] == 2,
+         "operations counted by kind");
+  Check (after.count[STATS_CHECKUNITS] - before.count[STATS_CHECKUNITS] == 4,
+         "unit checks counted");
+  Check (after.count[STATS_EXCEPTIONS] - before.count[STATS_EXCEPTIONS] == 1,
+         "exceptions counted");
+  Check (after.registryHighWater > 0, "registry high-water mark");
+  Check (hookCalls == 5, "hook called for every second build-up");
+#else
+  Check (! after.enabled && after.count[STATS_ADDS] == 0 && hookCalls == 0,
+         "no stats without MEASURE_STATS");
+  (void) before;
+#endif
+}
+
+
+// the non-throwing versions, and checking lots of Measures at once
+void TestTryMethods (void)
+{
+  Measure   a = Measure (4, &METER);
+  Measure   b = Measure (2, &METER);
+  Measure   t = Measure (2, &SECOND);
+  Measure   r = Measure (-1, &SECOND);  // (Try*'s result needn't match)
+  Measure   ms[130];
+  uint64_t  bad[3];
+  int       i;
+  int       ok;
+
+  Check (a.TryAdd (b, &r) == MEASURE_OK && r.GetQuantity() == 6 &&
+         r.GetUnit() == &METER, "TryAdd");
+  Check (a.TrySub (t, &r) == MEASURE_MISMATCH && r.GetQuantity() == 6,
+         "TrySub mismatch leaves result alone");
+  Check (a.TryDiv (t, &r) == MEASURE_OK && r.GetQuantity() == 2 &&
+         *r.GetUnit() == MpS, "TryDiv");
+  Check (a.TryRoot (2, &r) == MEASURE_BADROOT, "TryRoot of meters");
+  Check (Measure (9, &M2).TryRoot (2, &r) == MEASURE_OK &&
+         r.GetQuantity() == 3 && r.GetUnit() == &METER, "TryRoot");
+  Check (a.TryPower (200, &r) == MEASURE_OVERFLOW, "TryPower overflow");
+  Check (a.TryPower (0, &r) == MEASURE_OK && r.GetQuantity() == 1 &&
+         r.GetUnit() == &Unit::UNITLESS, "TryPower (0)");
+  Check (a.TryPower (100, &r) == MEASURE_OK &&
+         r.TryMul (r, &r) == MEASURE_OVERFLOW, "TryMul overflow");
+  Check (a.TryAssign (t) == MEASURE_MISMATCH && a.GetQuantity() == 4,
+         "TryAssign mismatch");
+  Check (a.TryAssign (b) == MEASURE_OK && a.GetQuantity() == 2,
+         "TryAssign");
+
+  for (i = 0; i < 130; i++)
+  {
+    Measure  m = Measure (i, (i % 3 == 0) ? &SECOND : &METER);
+    ms[i].TryAssign (m);
+  }
+  ms[1].TryAssign (Measure (1, Unit::FindUnitByBuildup (&MpS, '*',
+                                                         &SECOND)));
+  Check (Measure::Validate (ms, 130, &METER, bad) == 44, "Validate count");
+  ok = 1;
+  for (i = 0; i < 130; i++)
+  {
+    ok &= (int) ((bad[i / 64] >> (i % 64)) & 1) == (i % 3 == 0);
+  }
+  Check (ok && (bad[2] >> 2) == 0, "Validate bitmask");
+}
+
+
+// Units' ids: one per dimension, which is what Measures compare
+void TestUnitIds (void)
+{
+  Unit *  temp;
+  UnitId  id;
+  int     ok = 0;
+
+  Check (METER.GetId() != 0 && METER.GetId() != SECOND.GetId() &&
+         Unit::FromId (METER.GetId()) == &METER && Unit::FromId (0) == NULL,
+         "catalogue ids");
+  Check (Measure().GetUnitId() == 0 &&
+         Measure (1, &METER).GetUnitId() == METER.GetId(), "Measure ids");
+  {
+    Unit  metre ("metre", &METER, '*', &Unit::UNITLESS);
+
+    Check (metre.GetId() == METER.GetId() &&
+           Measure (1, &metre) == Measure (1, &METER) &&
+           Measure (1, &metre).GetUnit() == &METER,
+           "the same dimension, the same id");
+  }
+  Check (Unit::FromId (METER.GetId()) == &METER, "id kept by the first");
+  temp = METER.power (11);
+  id = temp->GetId();
+  {
+    Unit  m11 ("m^11", temp, '*', &Unit::UNITLESS);
+
+    Check (m11.GetId() == id && Unit::FromId (id) == &m11,
+           "a named Unit's id rather than a temp's");
+  }
+  Check (Unit::FromId (id) == temp, "and back to the temp");
+  // (in a chunk of the table never needed, and past the table)
+  Check (Unit::FromId (IDCHUNKSIZE * 5 + 7) == NULL &&
+         Unit::FromId ((UnitId) IDCHUNKS * IDCHUNKSIZE) == NULL &&
+         Unit::FromId (0xffffffff) == NULL, "ids never given out");
+  try
+  {
+    Measure (1, &METER) += Measure (1, &SECOND);
+  }
+  catch (Unit::MismatchError & e)
+  {
+    ok = (e.u1 == &METER && e.u2 == &SECOND);
+  }
+  Check (ok, "mismatch names the Units");
+}
+
+
+// the build-up cache: a repeat is a hit, but nothing comes back from it
+// once a Unit has gone away, even if another Unit has taken its room
+void TestBuildupCache (void)
+{
+  Dimension  d;
+  Unit *     u;
+  Unit *     other;
+  ulong      epoch;
+  ulong      hits;
+  ulong      misses;
+  ulong      hits2;
+  ulong      misses2;
+
+  KILOGRAM.GetDimension().Buildup ('*', M2.GetDimension(), &d);
+  {
+    Unit  ohms ("ohms", &OHM, '*', &Unit::UNITLESS);
+
+    Unit::GetBuildupCacheStats (&hits, &misses);
+    u = Unit::TryBuildup (&ohms, '*', &COULOMB);
+    Unit::GetBuildupCacheStats (&hits2, &misses2);
+    Check (hits2 == hits && misses2 == misses + 1, "a new Unit's miss");
+    Check (Unit::TryBuildup (&ohms, '*', &COULOMB) == u &&
+           Unit::TryBuildup (&OHM, '*', &COULOMB) == u, "the same result");
+    Unit::GetBuildupCacheStats (&hits, &misses);
+    Check (hits == hits2 + 1 && misses == misses2 + 1, "then a hit");
+    epoch = Unit::GetEpoch();
+  }
+  Check (Unit::GetEpoch() > epoch, "a Unit going away bumps the epoch");
+  Unit::GetBuildupCacheStats (&hits, &misses);
+  Unit::TryBuildup (&OHM, '*', &COULOMB);
+  Unit::GetBuildupCacheStats (&hits2, &misses2);
+  Check (hits2 == hits && misses2 == misses + 1, "and makes a miss");
+
+  // (the next temp made will likely go where the reclaimed one was)
+  u = Unit::TryBuildup (&KILOGRAM, '*', &M2);
+  Check (Unit::TryBuildup (&KILOGRAM, '*', &M2) == u, "a temp, cached");
+  epoch = Unit::GetEpoch();
+  Unit::ReclaimTemps();
+  Check (Unit::GetEpoch() > epoch, "ReclaimTemps bumps the epoch");
+  other = Unit::TryBuildup (&SECOND, '*', &M2);
+  Unit::GetBuildupCacheStats (&hits, &misses);
+  u = Unit::TryBuildup (&KILOGRAM, '*', &M2);
+  Unit::GetBuildupCacheStats (&hits2, &misses2);
+  Check (hits2 == hits && misses2 == misses + 1 && u != other &&
+         u->GetDimension() == d, "no reclaimed temp from the cache");
+  Check (Unit::TryBuildup (&KILOGRAM, '*', &M2) == u, "cached again");
+}
+
+
+// ReclaimTemps: kept temps stay as they were, reclaimed ones' room is
+// used again, and a temp made there gets a name of its own
+void TestReclaimTemps (void)
+{
+  UnitVector  keep;
+  Unit *      kept;
+  Unit *      gone;
+  Unit *      again;
+  Unit *      remade;
+  Dimension   d;
+  string      keptName;
+  string      goneName;
+  string      name;
+
+  Unit::ReclaimTemps();
+  kept = METER.power (5);
+  gone = SECOND.power (5);
+  keptName = kept->GetName();
+  goneName = gone->GetName();
+  d = kept->GetDimension();
+  keep.push_back (kept);
+  Check (Unit::ReclaimTemps (&keep) == 1, "reclaim all but the kept one");
+  Check (Unit::FindUnitByDimension (d) == kept && kept->GetDimension() == d &&
+         kept->GetName() == keptName && METER.power (5) == kept,
+         "the kept temp is still there");
+  again = KILOGRAM.power (5);
+  name = again->GetName();
+  Check (again == gone && again->GetDimension().GetExponent (1) == 5,
+         "a reclaimed temp's room used again");
+  Check (name.compare (0, 5, " TEMP") == 0 && name != goneName &&
+         name != keptName && again->GetName() == name,
+         "a new name for a temp in reclaimed room");
+  remade = SECOND.power (5);
+  Check (remade != again && remade != kept &&
+         remade->GetName() != goneName && remade->GetName() != name,
+         "a reclaimed temp made again is a new one");
+  Check (Unit::ReclaimTemps() == 3 && Unit::ReclaimTemps() == 0,
+         "then all reclaimed, once");
+}
+
+
+// lazy expressions: the same answers as the operators, in one pass
+void TestLazy (void)
+{
+  double        q[5] = { 0.5, 1, 2.5, 4, 7 };
+  MeasureArray  t (&SECOND, q, 5);
+  MeasureArray  few (&SECOND, q, 3);
+  MeasureArray  eager = t.power (2) * G * 0.5;
+  MeasureArray  lazy = Lazy (G) * 0.5 * Lazy (t).power <2> ();
+  Measure       time = Measure (3, &SECOND);
+  Measure       h = Measure (&METER);
+  Measure       off;
+  int           i;
+  int           ok;
+
+  h = Lazy (G) * 0.5 * Lazy (time).power <2> ();
+  Check (h == G * 0.5 * time.power (2), "lazy Measure");
+  off = (Lazy (h) * 2.0 / G).root <2> () - time;
+  Check (fabs (off.GetQuantity()) < 1e-12, "lazy root");
+  ok = (lazy.GetUnit() == &METER && lazy.GetSize() == 5);
+  for (i = 0; i < 5; i++)
+  {
+    ok &= (lazy.GetQuantities()[i] == eager.GetQuantities()[i]);
+  }
+  Check (ok, "lazy MeasureArray");
+  // (the same expression, so the same remembered Unit, till the
+  // operands' Units change)
+  ok = 1;
+  for (i = 0; i < 4; i++)
+  {
+    Measure  x = Measure (2, (i < 2) ? &METER : &SECOND);
+    Measure  y = Lazy (x) * x;
+
+    ok &= (*y.GetUnit() == *((i < 2) ? &M2 : SECOND.power (2)));
+  }
+  Check (ok, "lazy Unit remembered, and worked out again");
+  ok = 0;
+  try
+  {
+    h = Lazy (h) + time;
+  }
+  catch (Unit::MismatchError &)
+  {
+    ok = 1;
+  }
+  Check (ok, "lazy mismatch");
+  ok = 0;
+  try
+  {
+    MeasureArray  sum = Lazy (t) + Lazy (few);
+  }
+  catch (MeasureArray::SizeMismatchError &)
+  {
+    ok = 1;
+  }
+  Check (ok, "lazy size mismatch");
+}
+
+
+// whether a + b compiles (see TestStaticMeasures)
+template <class A, class B>
+concept Addable = requires (A a, B b) { a + b; };
+
+
+// StaticMeasures: the dimension algebra done by the compiler, and the
+// conversions to and from plain Measures checked when they happen
+void TestStaticMeasures (void)
+{
+  constexpr StaticLength  d = StaticLength (9.8);
+  constexpr StaticTime    t = StaticTime (2);
+  StaticVelocity          v;
+  StaticUnitless          none;
+  int                     thrown;
+
+  static_assert (is_same <decltype (d / t), StaticVelocity>::value &&
+                 is_same <decltype (d / t / t), StaticAcceleration>::value &&
+                 is_same <decltype (StaticMass (1) * (d / t / t)),
+                          StaticForce>::value &&
+                 is_same <decltype (1.0 / t), StaticMeasure <0, 0, -1, 0>>
+                   ::value &&
+                 is_same <decltype (d.power <2> ()), StaticArea>::value,
+                 "StaticMeasure dimension algebra");
+  static_assert ((d / t).GetQuantity() == 4.9 &&
+                 (0.5 * d * t.power <2> ()).GetQuantity() == 19.6 &&
+                 d + d == StaticLength (19.6),
+                 "StaticMeasure arithmetic at compile time");
+  static_assert (Addable <StaticLength, StaticLength> &&
+                 ! Addable <StaticLength, StaticTime> &&
+                 ! Addable <StaticLength, double> &&
+                 ! Addable <StaticEnergy, StaticPower>,
+                 "mismatched StaticMeasures don't add");
+  Check (StaticForce::GetUnit() == &NEWTON &&
+         StaticUnitless::GetUnit() == &Unit::UNITLESS &&
+         StaticMeasure <0, 0, 0, 1>::GetUnit() == &COULOMB,
+         "StaticMeasure Units");
+  v = StaticVelocity (Measure (3, &MpS));
+  Check (v.GetQuantity() == 3 && Measure (v) == Measure (3, &MpS) &&
+         StaticArea (Measure (16, &M2)).root <2> () == StaticLength (4),
+         "StaticMeasure to and from Measure");
+  thrown = 0;
+  try { StaticVelocity (Measure (3, &METER)); }
+  catch (Unit::MismatchError) { thrown = 1; }
+  Check (thrown, "StaticMeasure from a Measure in another Unit");
+  thrown = 0;
+  try { none = StaticUnitless (Measure()); }
+  catch (Unit::MismatchError e) { thrown = (e.u1 == NULL); }
+  Check (thrown, "StaticMeasure from a Measure of no Unit");
+}
+
+
+// the batch modes of falltime and falldist: the very same answers, bit
+// for bit, as doing one height or time at a time
+void TestTrajectory (void)
+{
+  MeasureArray  heights (&METER, 10000);
+  MeasureArray  times;
+  MeasureArray  dists;
+  uint64_t      r = 12345;
+  size_t        i;
+  int           ok = 1;
+
+  for (i = 0; i < heights.GetSize(); i++)
+  {
+    r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+    heights.GetQuantities()[i] = (r >> 11) * 0x1p-53 * 1000;
+  }
+  times = FallTimes (heights, G);
+  dists = FallDistances (times, G);
+  for (i = 0; i < heights.GetSize(); i++)
+  {
+    Measure  t = (heights.Get (i) * 2.0 / G).root (2);
+    Measure  d = Lazy (G) * 0.5 * Lazy (t).power <2> ();
+    double   one[2] = { t.GetQuantity(), d.GetQuantity() };
+    double   batch[2] = { times.GetQuantities()[i], dists.GetQuantities()[i] };
+
+    ok &= (memcmp (one, batch, sizeof (one)) == 0);
+  }
+  Check (ok && times.GetUnit() == &SECOND, "batch fall times and distances");
+}
+
+
+// Measures of float and long double: the same rules, in their own types
+void TestPrecision (void)
+{
+  FloatMeasure  f = FloatMeasure (1.1, &METER);
+  FloatMeasure  fs[3] = { f, f, FloatMeasure (1, &SECOND) };
+  Measure       d = Measure (f);
+  LongMeasure   l = LongMeasure (Measure (1.1, &METER));
+  uint64_t      bad[1];
+  int           ok = 0;
+  // (a T that measure.cpp doesn't make, so this only links if the
+  // templates are all in the header)
+  BasicMeasure <int>  n = BasicMeasure <int> (3, &METER);
+  BasicMeasure <int>  ns[2] = { n, BasicMeasure <int> (3, &SECOND) };
+
+  static_assert (is_same <decltype ((f + f).GetQuantity()), float>::value &&
+                 ! is_convertible <Measure, FloatMeasure>::value &&
+                 ! is_convertible <FloatMeasure, Measure>::value,
+                 "float arithmetic stays float; conversions are explicit");
+  Check (f.GetQuantity() == 1.1f && d.GetQuantity() == (double) 1.1f &&
+         d.GetUnit() == &METER && l.GetQuantity() == (long double) 1.1,
+         "converting between precisions");
+  Check ((f * f).GetUnit() == &M2 && (f * 2).GetQuantity() == 2.2f &&
+         f.power (2).GetQuantity() == 1.1f * 1.1f &&
+         FloatMeasure (4, &M2).sqrt().GetQuantity() == 2 &&
+         (l / l).GetUnit() == &Unit::UNITLESS, "float and long double math");
+  try
+  {
+    f += fs[2];
+  }
+  catch (Unit::MismatchError &)
+  {
+    ok = 1;
+  }
+  Check (ok && f.TryAdd (fs[2], &f) == MEASURE_MISMATCH, "float mismatch");
+  Check (FloatMeasure::Validate (fs, 3, &METER, bad) == 1 && bad[0] == 4,
+         "float Validate");
+  Check (n.power (3).GetQuantity() == 27 && n.power (3).GetUnit() ==
+         METER.power (3) && n.TryAdd (ns[1], &n) == MEASURE_MISMATCH &&
+         BasicMeasure <int>::Validate (ns, 2, &METER, bad) == 1,
+         "Measures of another type");
+  // (roots of whole numbers are rounded, not cut down to 1)
+  Check (BasicMeasure <int> (9, &M2).root (2).GetQuantity() == 3 &&
+         BasicMeasure <int> (9, &M2).root (2).GetUnit() == &METER &&
+         BasicMeasure <int> (10, &M2).sqrt().GetQuantity() == 3 &&
+         BasicMeasure <int> (27, METER.power (3)).cbrt().GetQuantity() == 3 &&
+         BasicMeasure <int> (16, METER.power (4)).root (-4).GetQuantity()
+           == 1 &&
+         BasicMeasure <int> (2, &METER).power (-1).GetQuantity() == 1,
+         "whole-number roots and reciprocals");
+}
+
+
 int main (int argc, char * argv[])
 {
   cout << Unit::GetAllBreakdowns();
+  TestCatalogue();
+  TestDimensions();
+  TestPowersAndRoots();
+  TestConversions();
+  TestAffine();
+  TestReductions();
+  TestFormulas();
+  TestUnitStrings();
+  TestMeasureFiles();
+  TestQuantityStreams();
+  TestTryMethods();
+  TestUnitIds();
+  TestBuildupCache();
+  TestReclaimTemps();
+  TestLazy();
+  TestTrajectory();
+  TestStaticMeasures();
+  TestPrecision();
+  TestStats();
+  if (failures != 0) cerr << failures << " checks failed" << endl;
+  return failures != 0;
 }
 
 
@@ -0,0 +1,205 @@
+/*
+threadpool.cpp (Copyright 2003 David J. Aronson)
+A pool of worker threads that share out a range of work, each taking
+from the others when it runs out.
+See also threadpool.hpp, reduction.*
+*/
+
+#include "threadpool.hpp"
+
+
+// PUBLIC STUFF
+
+
+// Constructors
+
+
+ThreadPool::ThreadPool (int threads)
+{
+  int  i;
+
+  if (threads <= 0) threads = thread::hardware_concurrency();
+  if (threads <= 0) threads = 1;
+  job = NULL;
+  generation = 0;
+  stopping = 0;
+  for (i = 0; i < threads; i++) queues.push_back (new Queue);
+  for (i = 1; i < threads; i++) workers.push_back (thread (&ThreadPool::Work,
+                                                           this, i));
+}
+
+
+// Destructor
+
+
+ThreadPool::~ThreadPool (void)
+{
+  size_t  i;
+
+  {
+    lock_guard <mutex>  lock (jobLock);
+    stopping = 1;
+  }
+  jobReady.notify_all();
+  for (i = 0; i < workers.size(); i++) workers[i].join();
+  for (i = 0; i < queues.size(); i++) delete queues[i];
+}
+
+
+// Member methods
+
+
+// do f on all of [0, n), a piece at a time, on all the threads
+void ThreadPool::ParallelFor (size_t n, size_t grain, const RangeFunction & f)
+{
+  Job    j;
+  Piece  all;
+
+  if (n == 0) return;
+  if (grain == 0) grain = 1;
+  // (not worth waking anyone for)
+  if (queues.size() == 1 || n <= grain)
+  {
+    f (0, n);
+    return;
+  }
+  lock_guard <mutex>  run (runLock);
+  j.f = &f;
+  j.grain = grain;
+  j.left.store (n);
+  j.joined = 0;
+  all.begin = 0;
+  all.end = n;
+  {
+    lock_guard <mutex>  lock (queues[0]->lock);
+    queues[0]->pieces.push_back (all);
+  }
+  {
+    lock_guard <mutex>  lock (jobLock);
+    job = &j;
+    generation++;
+  }
+  jobReady.notify_all();
+  Run (0, &j);
+  // j lives here, so wait for any worker still looking at it
+  unique_lock <mutex>  lock (jobLock);
+  job = NULL;
+  jobLeft.wait (lock, [&j] { return j.joined == 0; });
+}
+
+
+// Static methods
+
+
+// one for everyone to share, with a thread per CPU, made when first
+// asked for
+ThreadPool * ThreadPool::GetDefault (void)
+{
+  static ThreadPool  pool (0);
+
+  return &pool;
+}
+
+
+// PROTECTED STUFF
+
+
+// Member methods
+
+
+// a worker thread: wait for a job, help with it, and so on, till the
+// pool goes away
+void ThreadPool::Work (int self)
+{
+  unsigned long  seen = 0;
+
+  for (;;)
+  {
+    Job *  j;
+
+    {
+      unique_lock <mutex>  lock (jobLock);
+
+      jobReady.wait (lock, [this, seen]
+                     {
+                       return stopping || (job != NULL && generation != seen);
+                     });
+      if (stopping) return;
+      seen = generation;
+      j = job;
+      j->joined++;
+    }
+    Run (self, j);
+    {
+      lock_guard <mutex>  lock (jobLock);
+      j->joined--;
+    }
+    jobLeft.notify_all();
+  }
+}
+
+
+// take pieces of j and do them, till there's none of j left
+void ThreadPool::Run (int self, Job * j)
+{
+  Piece  p;
+
+  while (j->left.load (memory_order_acquire) != 0)
+  {
+    // (nothing to take, but someone's still busy: they may yet split
+    // something off)
+    if (! Take (self, &p))
+    {
+      this_thread::yield();
+      continue;
+    }
+    while (p.end - p.begin > j->grain)
+    {
+      Piece               rest;
+      lock_guard <mutex>  lock (queues[self]->lock);
+
+      rest.begin = p.begin + (p.end - p.begin) / 2;
+      rest.end = p.end;
+      p.end = rest.begin;
+      queues[self]->pieces.push_back (rest);
+    }
+    (*j->f) (p.begin, p.end);
+    j->left.fetch_sub (p.end - p.begin, memory_order_acq_rel);
+  }
+}
+
+
+// the last piece from our own deque, or failing that, the first from
+// someone else's
+int ThreadPool::Take (int self, Piece * p)
+{
+  int  n = (int) queues.size();
+  int  i;
+
+  {
+    lock_guard <mutex>  lock (queues[self]->lock);
+
+    if (! queues[self]->pieces.empty())
+    {
+      *p = queues[self]->pieces.back();
+      queues[self]->pieces.pop_back();
+      return 1;
+    }
+  }
+  for (i = 1; i < n; i++)
+  {
+    Queue *             q = queues[(self + i) % n];
+    lock_guard <mutex>  lock (q->lock);
+
+    if (! q->pieces.empty())
+    {
+      *p = q->pieces.front();
+      q->pieces.pop_front();
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+// END OF FILE
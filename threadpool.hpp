@@ -0,0 +1,87 @@
+/*
+threadpool.hpp (Copyright 2003 David J. Aronson)
+A pool of worker threads that share out a range of work, each taking
+from the others when it runs out.
+See also threadpool.cpp, reduction.*
+*/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+// what ParallelFor calls, on each piece [begin, end) of its range
+typedef function <void (size_t begin, size_t end)>  RangeFunction;
+
+
+// ParallelFor (n, grain, f) calls f on pieces of [0, n), none bigger
+// than grain, spread over the pool's threads, and returns when they're
+// all done.  Each thread keeps its own deque of pieces.  It takes the
+// last one (the one it split most recently), and halves it till it's
+// no bigger than grain, pushing the other halves back; when it has
+// none, it steals the first (and biggest) from another thread.  The
+// calling thread works too, as thread 0, so a pool of one thread has
+// no workers at all.  One ParallelFor runs on a pool at a time; any
+// others wait their turn.  f must not throw.
+class ThreadPool
+{
+public:
+  // Constructors
+  ThreadPool (int threads = 0);   // 0 for one per CPU
+  ThreadPool (const ThreadPool & p) = delete;
+  // Destructor
+  ~ThreadPool (void);
+  // Member methods
+  int   GetThreads (void) const { return (int) queues.size(); }
+  void  ParallelFor (size_t n, size_t grain, const RangeFunction & f);
+  // Static methods
+  static ThreadPool *  GetDefault (void);
+protected:
+  struct Piece
+  {
+    size_t  begin;
+    size_t  end;
+  };
+  struct Queue
+  {
+    mutex          lock;
+    deque <Piece>  pieces;
+  };
+  struct Job
+  {
+    const RangeFunction *  f;
+    size_t                 grain;
+    atomic <size_t>        left;     // how much of the range isn't done
+    int                    joined;   // workers still on it (jobLock)
+  };
+  // Member data
+  vector <Queue *>     queues;       // one per thread; [0] is the caller's
+  vector <thread>      workers;
+  mutex                runLock;      // one ParallelFor at a time
+  mutex                jobLock;      // for job, generation, stopping
+  condition_variable   jobReady;
+  condition_variable   jobLeft;      // a worker's done with the job
+  Job *                job;          // NULL between ParallelFors
+  unsigned long        generation;   // bumped for each job
+  int                  stopping;
+  // Member methods
+  void  Work (int self);
+  void  Run (int self, Job * j);
+  int   Take (int self, Piece * p);
+};
+
+
+#endif // ifndef THREADPOOL_H
+
+
+// END OF FILE
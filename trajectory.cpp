@@ -0,0 +1,46 @@
+/*
+trajectory.cpp (Copyright 2003 David J. Aronson)
+Falling-object formulas over whole arrays of heights or times, for the
+batch modes of falltime and falldist.
+See also trajectory.hpp, measurearray.*
+*/
+
+#include "measureexpr.hpp"
+#include "simd.hpp"
+#include "trajectory.hpp"
+#include "unit.hpp"
+
+
+// The result Units are worked out once per call, the same way the
+// single-Measure versions would (so a height that isn't a length, say,
+// still throws), and then the quantities are done in vector passes, the
+// later ones in place (FallTimes), or in one (FallDistances).
+
+
+// (in the same order as falltime's (height * 2.0 / G).root (2), so each
+// answer is the very one it would give: multiplying by a ready-made
+// 2 / a instead rounds differently)
+MeasureArray FallTimes (MeasureArray & heights, Measure a)
+{
+  Unit *        u = Unit::FindUnitByBuildup (heights.GetUnit(), '/',
+                                             a.GetUnit())->root (2);
+  size_t        n = heights.GetSize();
+  MeasureArray  result (u, n, MeasureArray::NOINIT);
+  double *      out = result.GetQuantities();
+
+  SimdMulScalar (heights.GetQuantities(), 2.0, out, n);
+  SimdDivScalar (out, a.GetQuantity(), out, n);
+  SimdRoot (out, 2, out, n);
+  return result;
+}
+
+
+// (as a lazy expression: one pass, with the Unit remembered from last
+// time; see measureexpr.hpp)
+MeasureArray FallDistances (MeasureArray & times, Measure a)
+{
+  return Lazy (a) * 0.5 * Lazy (times).power <2> ();
+}
+
+
+// END OF FILE
@@ -0,0 +1,25 @@
+/*
+trajectory.hpp (Copyright 2003 David J. Aronson)
+Falling-object formulas over whole arrays of heights or times, for the
+batch modes of falltime and falldist.
+See also trajectory.cpp, measurearray.*
+*/
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "measure.hpp"
+#include "measurearray.hpp"
+
+
+// How long each height takes to fall at acceleration a: t = sqrt (2d/a)
+MeasureArray  FallTimes (MeasureArray & heights, Measure a);
+
+// How far something falls in each time at acceleration a: d = 1/2 a t^2
+MeasureArray  FallDistances (MeasureArray & times, Measure a);
+
+
+#endif // ifndef TRAJECTORY_H
+
+
+// END OF FILE
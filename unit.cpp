@@ -6,85 +6,344 @@ See also measure.*
 
 
 #include <math.h>
+#include <algorithm>
 #include <iostream>
+#include <functional>
+#include <new>
+#include <string.h>
 #include <vector>
 using namespace std;
 
 
+#include "measure.hpp"
+#include "measuredefs.hpp"
 #include "unit.hpp"
+#include "unitdefs.hpp"
 
 
-// NOTE: THESE FOUR ARE OUT OF THE USUAL ORDER BECAUSE
-// THEY MUST BE INITTED BEFORE ANY UNITS CAN BE CREATED!!!
-UnitVector Unit::knownUnits;  // should replace with class introspection....
-UnitVector Unit::baseUnits;
-ulong Unit::lastPrime = 1;    // yes, that's not a prime... see Unit (name)
-ulong Unit::lastTemp = 0;
+// a bound on the n'th prime, for sizing the sieve: it's under
+// n (ln n + ln ln n) for n >= 6, which is under 2 n log2 n
+static constexpr size_t PrimeBound (size_t n)
+{
+  size_t  bits = 1;
+
+  while (((size_t) 1 << bits) < n) bits++;
+  return 2 * n * bits + 16;
+}
+
 
+// the sieve of Eratosthenes, run by the compiler
+constexpr Unit::PrimeTable::PrimeTable (void) : prime()
+{
+  bool    composite[PrimeBound (MAXBASEUNITS)] = { };
+  size_t  i = 2;
+  size_t  j = 0;
+  int     found = 0;
 
-// must be in Unit to be able to dictate numerator and denominator,
-// plus it makes sense since it's not part of one specific system of units
-Unit Unit::UNITLESS = Unit ("unitless", 1, 1);
+  for (; found < MAXBASEUNITS; i++)
+  {
+    if (composite[i]) continue;
+    prime[found++] = i;
+    for (j = i * i; j < sizeof (composite); j += i) composite[j] = true;
+  }
+}
 
 
+// THE CATALOGUE
+// The standard Units.  Everything about them -- their dimensions, and
+// where they go in the registry's indexes -- is worked out by the
+// compiler, so they're all there before any code runs: there's nothing
+// to do for them at startup, and no order to get them made in.  Base
+// units get the first slots, in the order they're listed here.
 // TODO: these should be moved out to an optional codefile
-// first we declare some universal units...
-Unit SECOND = Unit ("second");
-// now some metric units...
-Unit KILOGRAM = Unit ("kilogram");
-Unit METER = Unit ("meter");
-Unit COULOMB = Unit ("coulomb");
-Unit MpS = Unit ("m/s", &METER, '/', &SECOND);
-Unit MpSpS = Unit ("m/s^2", &MpS, '/', &SECOND);
-Unit NEWTON = Unit ("newton", &KILOGRAM, '*', &MpSpS);
-Unit JOULE = Unit ("joule", &METER, '*', &NEWTON);
-Unit WATT = Unit ("watt", &JOULE, '/', &SECOND);
-Unit M2 = Unit ("m^2", &METER, '*', &METER);
-Unit PASCAL = Unit ("pascal", &NEWTON, '/', &M2);
-Unit AMPERE = Unit ("ampere", &COULOMB, '/', &SECOND);
-Unit VOLT = Unit ("volt", &WATT, '/', &AMPERE);
-Unit OHM = Unit ("ohm", &VOLT, '/', &AMPERE);
-// now the "English" units...
-Unit FOOT = Unit ("foot");
-Unit SLUG = Unit ("slug");  // THIS is the unit of mass!  Lbs are FORCE!
-Unit FPS = Unit ("fps", &FOOT, '/', &SECOND);
-Unit FPSPS = Unit ("fpsps", &FPS, '/', &SECOND);
-Unit POUND = Unit ("pound", &SLUG, '*', &FPSPS);  // THIS IS FORCE, NOT MASS!!!
-Unit FOOTPOUND = Unit ("foot-pound", &FOOT, '*', &POUND);
-// ...and we'll skip anything else, including Knuth's first published work.
+static constexpr Unit::CatalogueEntry  catalogue[] =
+{
+  // must be in Unit to be able to dictate its dimension, plus it makes
+  // sense since it's not part of one specific system of units
+  { &Unit::UNITLESS, "unitless", "second", '/', "second" },
+  // first we declare some universal units...
+  { &SECOND, "second" },
+  // now some metric units...
+  { &KILOGRAM, "kilogram" },
+  { &METER, "meter" },
+  { &COULOMB, "coulomb" },
+  { &MpS, "m/s", "meter", '/', "second" },
+  { &MpSpS, "m/s^2", "m/s", '/', "second" },
+  { &NEWTON, "newton", "kilogram", '*', "m/s^2" },
+  { &JOULE, "joule", "meter", '*', "newton" },
+  { &WATT, "watt", "joule", '/', "second" },
+  { &M2, "m^2", "meter", '*', "meter" },
+  { &PASCAL, "pascal", "newton", '/', "m^2" },
+  { &AMPERE, "ampere", "coulomb", '/', "second" },
+  { &VOLT, "volt", "watt", '/', "ampere" },
+  { &OHM, "ohm", "volt", '/', "ampere" },
+  // now the "English" units...
+  { &FOOT, "foot" },
+  { &SLUG, "slug" },  // THIS is the unit of mass!  Lbs are FORCE!
+  { &FPS, "fps", "foot", '/', "second" },
+  { &FPSPS, "fpsps", "fps", '/', "second" },
+  { &POUND, "pound", "slug", '*', "fpsps" },  // THIS IS FORCE, NOT MASS!!!
+  { &FOOTPOUND, "foot-pound", "foot", '*', "pound" },
+  // ...and what it takes to convert between the two (see measuredefs.hpp)
+  { &FEETPERMETER, "feet per meter", "foot", '/', "meter" },
+  { &SLUGSPERKILOGRAM, "slugs per kilogram", "slug", '/', "kilogram" },
+  // (like FOOT, each of these is a base unit of its own; see measure.txt
+  // on converting between them)
+  { &INCH, "inch" },
+  { &YARD, "yard" },
+  { &MILE, "mile" },
+  // and temperature, for CELSIUS and FAHRENHEIT (see affine.hpp)
+  { &KELVIN, "kelvin" }
+  // ...and we'll skip anything else, including Knuth's first published work.
+};
+
+#define CATALOGUESIZE (sizeof (catalogue) / sizeof (catalogue[0]))
+
+// the size of the catalogue's slice of each registry index, to begin with
+#define CATALOGUEINDEXSIZE 64
+
+
+// The compiler's part.  Anything wrong with the catalogue (a Unit made
+// of one that isn't in it, say) stops these from being constant, so it
+// won't compile.  (Units are found by name, not address: with some
+// options, such as -fsanitize, the compiler won't compare addresses.)
+
+
+// where the Unit called n is in the catalogue
+static consteval size_t CatalogueIndex (string_view n)
+{
+  size_t  i;
 
+  for (i = 0; i < CATALOGUESIZE; i++)
+  {
+    if (n == catalogue[i].name) return i;
+  }
+  throw "Unit not in the catalogue";
+}
 
-// PUBLIC STUFF
 
+// the dimension of the i'th Unit in the catalogue
+static consteval Dimension CatalogueDims (size_t i)
+{
+  const Unit::CatalogueEntry &  e = catalogue[i];
+  Dimension                     d;
+  size_t                        j;
+  int                           slot = 0;
 
-// Constructors
+  if (e.op == 0)
+  {
+    for (j = 0; j < i; j++) slot += (catalogue[j].op == 0);
+    if (slot >= MAXBASEUNITS) throw "too many base units in the catalogue";
+    return Dimension::Base (slot);
+  }
+  if (e.op != '*' && e.op != '/') throw "bad operator in the catalogue";
+  if (! CatalogueDims (CatalogueIndex (e.u1)).Buildup
+          (e.op, CatalogueDims (CatalogueIndex (e.u2)), &d))
+  {
+    throw "exponent overflow in the catalogue";
+  }
+  return d;
+}
 
 
-// make a base unit
-Unit::Unit (string n)
+// each Unit's hash, by name or by dimension, for the indexes
+static consteval array <size_t, CATALOGUESIZE> CatalogueHashes (int byName)
 {
-  UnitIterator  basesEnd = baseUnits.end();
-  char          foundPrime;
-  UnitIterator  it;
+  array <size_t, CATALOGUESIZE>  h = { };
+  size_t                         i;
 
-  // find the next prime -- base units being primes is the key!
-  do
+  for (i = 0; i < CATALOGUESIZE; i++)
   {
-    ++lastPrime;
-    foundPrime = 1;
-    for (it = baseUnits.begin(); it != basesEnd && foundPrime != 0; it++)
+    h[i] = byName ? Unit::HashName (catalogue[i].name)
+                  : CatalogueDims (i).Hash();
+  }
+  return h;
+}
+
+
+static consteval array <Unit *, CATALOGUESIZE> CatalogueUnits (void)
+{
+  array <Unit *, CATALOGUESIZE>  u = { };
+  size_t                         i;
+
+  for (i = 0; i < CATALOGUESIZE; i++) u[i] = catalogue[i].unit;
+  return u;
+}
+
+
+// the base units, by slot
+static consteval array <Unit *, MAXBASEUNITS> CatalogueBaseUnits (void)
+{
+  array <Unit *, MAXBASEUNITS>  b = { };
+  size_t                        i;
+  int                           slot = 0;
+
+  for (i = 0; i < CATALOGUESIZE; i++)
+  {
+    if (catalogue[i].op == 0) b[slot++] = catalogue[i].unit;
+  }
+  return b;
+}
+
+
+// the first chunk of the Units-by-id table: the catalogue's Units get
+// ids 1 and up, in order.  (so no two of them may have the same
+// dimension.)
+static consteval array <Unit *, IDCHUNKSIZE> CatalogueIds (void)
+{
+  array <Unit *, IDCHUNKSIZE>  ids = { };
+  size_t                       i;
+  size_t                       j;
+  int                          slot;
+
+  if (CATALOGUESIZE >= IDCHUNKSIZE) throw "catalogue too big for its ids";
+  for (i = 0; i < CATALOGUESIZE; i++)
+  {
+    for (j = 0; j < i; j++)
     {
-      if (lastPrime % (*it)->numerator == 0) foundPrime = 0;
+      for (slot = 0; slot < MAXBASEUNITS; slot++)
+      {
+        if (CatalogueDims (i).GetExponent (slot) !=
+            CatalogueDims (j).GetExponent (slot)) break;
+      }
+      if (slot == MAXBASEUNITS) throw "two catalogue Units, one dimension";
     }
-  } while (foundPrime == 0);
-  UnitInit (n, lastPrime, 1);
-  baseUnits.push_back (this);
+    ids[i + 1] = catalogue[i].unit;
+  }
+  return ids;
+}
+
+
+static consteval int CatalogueBaseCount (void)
+{
+  size_t  i;
+  int     n = 0;
+
+  for (i = 0; i < CATALOGUESIZE; i++) n += (catalogue[i].op == 0);
+  return n;
+}
+
+
+// the id of the Unit called n (see CatalogueIds)
+static consteval UnitId CatalogueId (string_view n)
+{
+  return CatalogueIndex (n) + 1;
+}
+
+
+// make a catalogue Unit.  (its name stays in the catalogue, so it can be
+// as long as it likes and still be made by the compiler.)
+consteval Unit::Unit (const CatalogueEntry & e)
+  : name (e.name), ownName (), dims (CatalogueDims (CatalogueIndex (e.name))),
+    tempNumber (0), listed (1), pooled (0), builtIn (1),
+    id (CatalogueId (e.name)), buildupCache ()
+{ }
+
+
+// the catalogue entry for the Unit called n
+static consteval const Unit::CatalogueEntry & Catalogued (string_view n)
+{
+  return catalogue[CatalogueIndex (n)];
+}
+
+
+// THE REGISTRY
+// All constant-initialized, like the catalogue, so it's ready for Units
+// made by other files' static initializers, whatever order they run in.
+static constinit UnitIndex::Prebuilt <CATALOGUEINDEXSIZE>
+  catalogueByDims (CatalogueHashes (0).data(), CatalogueUnits().data(),
+                   CATALOGUESIZE);
+static constinit UnitIndex::Prebuilt <CATALOGUEINDEXSIZE>
+  catalogueByName (CatalogueHashes (1).data(), CatalogueUnits().data(),
+                   CATALOGUESIZE);
+static constinit array <Unit *, IDCHUNKSIZE>  catalogueIds = CatalogueIds();
+const Unit::PrimeTable Unit::basePrimes;
+constinit mutex Unit::registryLock;
+constinit UnitVector Unit::knownUnits;
+constinit array <Unit *, MAXBASEUNITS> Unit::baseUnits =
+  CatalogueBaseUnits();
+constinit int Unit::baseCount = CatalogueBaseCount();
+constinit UnitIndex Unit::dimsIndex (catalogueByDims, CATALOGUESIZE);
+constinit UnitIndex Unit::namesIndex (catalogueByName, CATALOGUESIZE);
+constinit vector <void *> Unit::tempChunks;
+constinit vector <void *> Unit::freeTemps;
+constinit ulong Unit::lastTemp = 0;
+constinit Unit ** Unit::idChunks[IDCHUNKS] = { catalogueIds.data() };
+constinit UnitId Unit::nextId = CATALOGUESIZE + 1;
+constinit vector <UnitId> Unit::freeIds;
+// (cacheEpoch starts at 1, so zeroed cache entries are no good)
+constinit atomic <ulong> Unit::cacheEpoch (1);
+constinit atomic <ulong> Unit::cacheHits (0);
+constinit atomic <ulong> Unit::cacheMisses (0);
+
+constinit Unit Unit::UNITLESS (Catalogued ("unitless"));
+constinit Unit SECOND (Catalogued ("second"));
+constinit Unit KILOGRAM (Catalogued ("kilogram"));
+constinit Unit METER (Catalogued ("meter"));
+constinit Unit COULOMB (Catalogued ("coulomb"));
+constinit Unit MpS (Catalogued ("m/s"));
+constinit Unit MpSpS (Catalogued ("m/s^2"));
+constinit Unit NEWTON (Catalogued ("newton"));
+constinit Unit JOULE (Catalogued ("joule"));
+constinit Unit WATT (Catalogued ("watt"));
+constinit Unit M2 (Catalogued ("m^2"));
+constinit Unit PASCAL (Catalogued ("pascal"));
+constinit Unit AMPERE (Catalogued ("ampere"));
+constinit Unit VOLT (Catalogued ("volt"));
+constinit Unit OHM (Catalogued ("ohm"));
+constinit Unit FOOT (Catalogued ("foot"));
+constinit Unit SLUG (Catalogued ("slug"));
+constinit Unit FPS (Catalogued ("fps"));
+constinit Unit FPSPS (Catalogued ("fpsps"));
+constinit Unit POUND (Catalogued ("pound"));
+constinit Unit FOOTPOUND (Catalogued ("foot-pound"));
+constinit Unit FEETPERMETER (Catalogued ("feet per meter"));
+constinit Unit SLUGSPERKILOGRAM (Catalogued ("slugs per kilogram"));
+constinit Unit INCH (Catalogued ("inch"));
+constinit Unit YARD (Catalogued ("yard"));
+constinit Unit MILE (Catalogued ("mile"));
+constinit Unit KELVIN (Catalogued ("kelvin"));
+
+
+// THE STANDARD MEASURES
+// Made by the compiler too, so they're as ready as the Units are.  (A
+// Measure made from a Unit pointer reads the Unit's id, which the
+// compiler can't do, so these go by the catalogue's ids instead.)
+// first some reasonably normal constants
+constinit Measure G = Measure::WithId (9.8, CatalogueId ("m/s^2"));
+// next some conversions
+constinit Measure CONVERT_FEETPERMETER =
+  Measure::WithId (3.280833333333333333333, CatalogueId ("feet per meter"));
+constinit Measure CONVERT_SLUGSPERKILOGRAM =
+  Measure::WithId (2.2, CatalogueId ("slugs per kilogram"));
+
+
+// PUBLIC STUFF
+
+
+// Constructors
+
+
+// make a base unit.  it gets the next free slot in Dimension, and so
+// the next prime number (basePrimes), which only matters for
+// GetBreakdown (for the "numerator/denominator" form the units used to
+// be kept in).
+Unit::Unit (string n)
+{
+  lock_guard <mutex>  lock (registryLock);
+  int                 slot = baseCount;
+
+  if (slot >= MAXBASEUNITS) throw BaseUnitLimitError (n);
+  UnitInit (n, Dimension::Base (slot));
+  baseUnits[baseCount++] = this;
 }
 
 
 // make a unit by multiplying or dividing existing units
 Unit::Unit (string n, Unit * u1, char op, Unit * u2)
 {
+  lock_guard <mutex>  lock (registryLock);
+
   if (op != '*' && op != '/') throw BadOperatorError (op);
   UnitBuildup (n, u1, op, u2);
   // eventually might check if it wound up identical to some base unit.
@@ -96,10 +355,14 @@ Unit::Unit (string n, Unit * u1, char op, Unit * u2)
 
 
 // delete units from lists where we might want to find them
+// (unless that's been done already; see ReclaimTemps)
 Unit::~Unit (void)
 {
-  DelFrom (&knownUnits, 1);
-  if (denominator == 1) DelFrom (&baseUnits, 0);
+  if (listed)
+  {
+    lock_guard <mutex>  lock (registryLock);
+    Unlist();
+  }
 }
 
 
@@ -109,79 +372,59 @@ Unit::~Unit (void)
 // Print the details of a unit, mainly for debugging purposes
 string Unit::GetBreakdown (void)
 {
-  char    buf[32];
-  string  s;
+  lock_guard <mutex>  lock (registryLock);
 
-  s = GetPartialBreakdown (numerator);
-  if (denominator != 1)
-  {
-    s += " / ";
-    s += GetPartialBreakdown (denominator);
-  }
-  sprintf (buf, " (%lu/%lu)", numerator, denominator);
-  s += buf;
-  return s;
+  return MakeBreakdown();
 }
 
 
 // raise a unit to a power, e.g., (m/s).power (3) = (m^3 / s^3)
 Unit * Unit::power (int power)
 {
-  ulong  d = denominator;
-  int    i;
-  ulong  n = numerator;
-  int    powTmp = (power > 0) ? power : -power;
+  Unit *  u = TryPower (power);
 
-  if (power == 0) return &UNITLESS;
-  if (power == 1) return this;
-  for (i = 1; i < powTmp; i++)
-  {
-    d *= denominator;
-    n *= numerator;
-  }
-  if (power < 0)
-  {
-    ulong u = d;
-    d = n;
-    n = u;
-  }
-  return FindOrMakeUnitByNumbers (n, d);
+  if (u == NULL) throw OverflowError (this);
+  return u;
 }
 
 
 // take the n'th root of a unit, e.g., (m^3 / s^3).root (3) = m/s
 Unit * Unit::root (int power)
 {
-  int    powTmp = (power > 0) ? power : -power;
-  ulong  den = (ulong) floor (pow (denominator, 1.0/powTmp));
-  ulong  num = (ulong) floor (pow (numerator, 1.0/powTmp));
-  ulong  swap;
+  Unit *  u = TryRoot (power);
 
-  // verify!
-  if ((ulong) floor (pow ((double) num, (double) powTmp)) != numerator)
-  {
-    throw BadRootError (this, power);
-  }
-  if ((ulong) floor (pow ((double) den, (double) powTmp)) != denominator)
-  {
-    throw BadRootError (this, power);
-  }
-  if (power < 0)
-  {
-    swap = den;
-    den = num;
-    num = swap;
-  }
-  return FindOrMakeUnitByNumbers (num, den);
+  if (u == NULL) throw BadRootError (this, power);
+  return u;
+}
+
+
+// the same, but returning NULL rather than throwing, for when bad input
+// is to be expected (see Measure::TryPower)
+Unit * Unit::TryPower (int power)
+{
+  Dimension  d;
+
+  if (power == 0) return &UNITLESS;
+  if (power == 1) return this;
+  if (! dims.Power (power, &d)) return NULL;
+  return FindOrMakeUnitByDims (d);
+}
+
+
+Unit * Unit::TryRoot (int power)
+{
+  Dimension  d;
+
+  if (power == 1) return this;
+  if (! dims.Root (power, &d)) return NULL;
+  return FindOrMakeUnitByDims (d);
 }
 
 
 // compare two units for equality
 int Unit::operator == (Unit & u)
 {
-  if (numerator != u.numerator) return 0;
-  if (denominator != u.denominator) return 0;
-  return 1;
+  return dims == u.dims;
 }
 
 
@@ -189,34 +432,210 @@ int Unit::operator == (Unit & u)
 
 
 // find the unit that matches a given construction from other units.
-// for now, simple linear search.
-// later, might replace by binary search, with knownUnits sorted
-// (probably on (numerator << (8 * sizeof (ulong)) + denominator)
-Unit * Unit::FindUnitByBuildup (Unit *  u1, char  op, Unit *  u2)
+// u1 remembers the last few of these it was in, in a little table
+// indexed by partner and op, so a repeat is a single lookup.  otherwise
+// it's a hash lookup (see FindUnitByDims), and we remember that.
+// returns NULL if op is no good or an exponent would overflow (see
+// FindUnitByBuildup, in unit.hpp, for the version that throws).
+Unit * Unit::TryBuildup (Unit *  u1, char  op, Unit *  u2)
 {
-  ulong  den;
-  ulong  num;
+  Dimension            d;
+  BuildupCacheEntry *  e;
+  Unit *               result;
+  unsigned             seq;
+  ulong                epoch;
+  STATS_TIME (STATS_BUILDUP);
+
+  if (op != '*' && op != '/') return NULL;
+  e = &u1->buildupCache[(((size_t) u2 >> 4) + (op == '/'))
+                        % BUILDUPCACHESIZE];
+  // Other threads may be doing the same, so each entry is a little
+  // seqlock: read it, then make sure seq didn't change meanwhile.
+  seq = e->seq.load (memory_order_acquire);
+  if ((seq & 1) == 0)
+  {
+    Unit *  partner = e->partner.load (memory_order_relaxed);
+    char    eOp = e->op.load (memory_order_relaxed);
+
+    epoch = e->epoch.load (memory_order_relaxed);
+    result = e->result.load (memory_order_relaxed);
+    atomic_thread_fence (memory_order_acquire);
+    if (e->seq.load (memory_order_relaxed) == seq && partner == u2 &&
+        eOp == op && epoch == cacheEpoch.load (memory_order_acquire))
+    {
+      cacheHits.fetch_add (1, memory_order_relaxed);
+      return result;
+    }
+  }
+  cacheMisses.fetch_add (1, memory_order_relaxed);
+  // (if a unit goes away while we work, what we find may be stale)
+  epoch = cacheEpoch.load (memory_order_acquire);
+  if (! u1->dims.Buildup (op, u2->dims, &d)) return NULL;
+  result = FindOrMakeUnitByDims (d);
+  // and when writing it, claim it by making seq odd.  if someone else
+  // got there first, never mind; it's only a cache.
+  if ((seq & 1) == 0 &&
+      e->seq.compare_exchange_strong (seq, seq + 1, memory_order_acquire))
+  {
+    atomic_thread_fence (memory_order_release);
+    e->partner.store (u2, memory_order_relaxed);
+    e->op.store (op, memory_order_relaxed);
+    e->result.store (result, memory_order_relaxed);
+    e->epoch.store (epoch, memory_order_relaxed);
+    e->seq.store (seq + 2, memory_order_release);
+  }
+  return result;
+}
+
 
+// what FindUnitByBuildup throws when TryBuildup can't do it
+void Unit::ThrowBuildupError (Unit * u1, char op)
+{
   if (op != '*' && op != '/') throw BadOperatorError (op);
-  CalcBuildupNumbers (u1, op, u2, &num, &den);
-  return FindOrMakeUnitByNumbers (num, den);
+  throw OverflowError (u1);
+}
+
+
+// Find a unit by its name, and if not found, return NULL
+Unit * Unit::FindUnitByName (string n)
+{
+  Unit *  found;
+  STATS_TIME (STATS_FINDBYNAME);
+
+  found = namesIndex.Find (HashName (n), [&n] (Unit * u)
+                           {
+                             return u->name == n;
+                           });
+  STATS_COUNT (STATS_LOOKUPS);
+  if (found == NULL) STATS_COUNT (STATS_LOOKUPMISSES);
+  return found;
+}
+
+
+// what the hot paths have been doing (see unitstats.hpp).  all zeros
+// (and enabled 0) unless compiled with MEASURE_STATS.
+UnitStats Unit::GetStats (void)
+{
+  UnitStats  s;
+
+#ifdef MEASURE_STATS
+  Stats::Sum (&s);
+  s.enabled = 1;
+#else
+  memset (&s, 0, sizeof (s));
+#endif
+  return s;
+}
+
+
+// have h told how long one in every "every" of the slower operations
+// takes (see StatsEvent), or stop, if h is NULL.  does nothing unless
+// compiled with MEASURE_STATS.
+void Unit::SetStatsHook (StatsHook h, ulong every)
+{
+  Stats::SetHook (h, every);
+}
+
+
+// Find the unit with a given dimension, making a temp one if need be
+// (as multiplying Measures would)
+Unit * Unit::FindUnitByDimension (Dimension d)
+{
+  return FindOrMakeUnitByDims (d);
+}
+
+
+// the base unit in a given slot of Dimension, or NULL if there's none
+// (or it's been destroyed)
+Unit * Unit::GetBaseUnit (int slot)
+{
+  lock_guard <mutex>  lock (registryLock);
+
+  if (slot < 0 || slot >= baseCount) return NULL;
+  return baseUnits[slot];
 }
 
 
 // print out all the units there are (mainly for debugging purposes)
 string Unit::GetAllBreakdowns (void)
 {
-  UnitIterator  end = knownUnits.end();
-  UnitIterator  it;
-  string        s = "";
+  lock_guard <mutex>  lock (registryLock);
+  UnitIterator        end = knownUnits.end();
+  UnitIterator        it;
+  string              s = "";
+  size_t              i;
+
+  for (i = 0; i < CATALOGUESIZE; i++)
+  {
+    Unit *  u = catalogue[i].unit;
+    if (u->listed) s += u->GetName() + ": " + u->MakeBreakdown() + '\n';
+  }
   for (it = knownUnits.begin(); it != end; it++)
   {
-    s += (*it)->GetName() + ": " + (*it)->GetBreakdown() + '\n';
+    s += (*it)->GetName() + ": " + (*it)->MakeBreakdown() + '\n';
   }
   return s;
 }
 
 
+// Destroy the temp units the system has made (see FindOrMakeUnitByDims)
+// that aren't in inUse (which may be NULL), and keep their room for the
+// next temps.  Returns how many were reclaimed.
+// Only call this at a quiescent point: no other thread may be using any
+// Unit, and no Measure or MeasureArray may have a temp Unit that isn't
+// in inUse.
+size_t Unit::ReclaimTemps (UnitVector * inUse)
+{
+  UnitVector          keep;
+  UnitVector          victims;
+  UnitIterator        it;
+  STATS_TIME (STATS_RECLAIM);
+  lock_guard <mutex>  lock (registryLock);
+
+  if (inUse != NULL) keep = *inUse;
+  sort (keep.begin(), keep.end());
+  for (it = knownUnits.begin(); it != knownUnits.end(); it++)
+  {
+    if ((*it)->pooled && ! binary_search (keep.begin(), keep.end(), *it))
+    {
+      victims.push_back (*it);
+    }
+  }
+  // take them all out of knownUnits in one pass, rather than one by one
+  knownUnits.erase (remove_if (knownUnits.begin(), knownUnits.end(),
+                               [&keep] (Unit * u)
+                               {
+                                 return u->pooled &&
+                                        ! binary_search (keep.begin(),
+                                                         keep.end(), u);
+                               }),
+                    knownUnits.end());
+  for (it = victims.begin(); it != victims.end(); it++)
+  {
+    (*it)->DelFromIndexes();
+    (*it)->GiveBackId();
+    (*it)->listed = 0;
+    (*it)->~Unit();
+    freeTemps.push_back (*it);
+  }
+  cacheEpoch++;
+  STATS_ADD (STATS_TEMPSRECLAIMED, victims.size());
+  // nobody's looking, so the indexes' old tables can go too
+  dimsIndex.FreeRetired();
+  namesIndex.FreeRetired();
+  return victims.size();
+}
+
+
+// how often FindUnitByBuildup found its answer in the build-up cache,
+// and how often it had to go looking
+void Unit::GetBuildupCacheStats (ulong * hits, ulong * misses)
+{
+  *hits = cacheHits.load (memory_order_relaxed);
+  *misses = cacheMisses.load (memory_order_relaxed);
+}
+
+
 // PROTECTED ITEMS
 
 
@@ -226,6 +645,8 @@ string Unit::GetAllBreakdowns (void)
 // make a TEMPORARY unit by multiplying or dividing existing units
 Unit::Unit (Unit * u1, char op, Unit * u2)
 {
+  lock_guard <mutex>  lock (registryLock);
+
   if (op != '*' && op != '/') throw BadOperatorError (op);
   UnitBuildup ("", u1, op, u2);
 }
@@ -234,6 +655,103 @@ Unit::Unit (Unit * u1, char op, Unit * u2)
 // Other member methods
 
 
+// a temp's name, made up when somebody asks for it
+string Unit::MakeTempName (void)
+{
+  char  tmpStr[32];
+
+  sprintf (tmpStr, " TEMP%lu", tempNumber);
+  return tmpStr;
+}
+
+
+// the guts of GetBreakdown; caller locks
+string Unit::MakeBreakdown (void)
+{
+  char    buf[48];
+  ulong   den;
+  ulong   num;
+  string  s;
+  string  bottom;
+
+  GetBreakdownParts (dims, &s, &bottom);
+  if (bottom != "")
+  {
+    s += " / ";
+    s += bottom;
+  }
+  if (GetNumbers (&num, &den)) sprintf (buf, " (%lu/%lu)", num, den);
+  else sprintf (buf, " (too big for %u-bit numbers)",
+                (unsigned) (8 * sizeof (ulong)));
+  s += buf;
+  return s;
+}
+
+
+// file a unit in the hash indexes, so Find* can get at it
+void Unit::AddToIndexes (void)
+{
+  dimsIndex.Add (this, dims.Hash());
+  if (name != "") namesIndex.Add (this, HashName (name));
+}
+
+
+// take a unit back out of the hash indexes
+void Unit::DelFromIndexes (void)
+{
+  dimsIndex.Remove (this, dims.Hash());
+  if (name != "") namesIndex.Remove (this, HashName (name));
+}
+
+
+// get this (new) unit's id: the one its dimension already has, or a
+// new one.  (caller locks; not in the indexes yet)
+void Unit::TakeId (void)
+{
+  Unit *  same = FindUnitByDims (dims);
+
+  if (same != NULL)
+  {
+    id = same->id;
+    // (a name is more use than a temp's number, to whoever gets it back)
+    if (FromId (id)->name == "" && name != "") SetIdUnit (id, this);
+    return;
+  }
+  if (! freeIds.empty())
+  {
+    id = freeIds.back();
+    freeIds.pop_back();
+  }
+  else
+  {
+    // (that's 16 million dimensions' worth of Units: memory's gone
+    // already)
+    if (nextId == (UnitId) IDCHUNKS * IDCHUNKSIZE) throw bad_alloc();
+    id = nextId++;
+    if (id % IDCHUNKSIZE == 0)
+    {
+      atomic_ref <Unit **> (idChunks[id / IDCHUNKSIZE])
+        .store (new Unit * [IDCHUNKSIZE] (), memory_order_release);
+    }
+  }
+  SetIdUnit (id, this);
+}
+
+
+// when a unit goes away, its id goes to another of its dimension, if
+// there is one, or else back for reuse.  (caller locks; already out of
+// the indexes)
+void Unit::GiveBackId (void)
+{
+  Unit *  other;
+
+  if (FromId (id) != this) return;
+  other = FindUnitByDims (dims);
+  SetIdUnit (id, other);
+  if (other == NULL) freeIds.push_back (id);
+}
+
+
 // delete unit from list, throwing error if required but not found
 void Unit::DelFrom (UnitVector * v, char mustFind)
 {
@@ -252,138 +770,211 @@ void Unit::DelFrom (UnitVector * v, char mustFind)
 }
 
 
+// Work out the numerator and denominator this unit would have had
+// back when units were products of primes: each base unit's prime,
+// raised to its exponent, on top or bottom depending on the sign.
+// Returns zero if either one won't fit in a ulong.
+int Unit::GetNumbers (ulong * num, ulong * den)
+{
+  int  slot;
+
+  *num = 1;
+  *den = 1;
+  for (slot = 0; slot < baseCount; slot++)
+  {
+    int     e = dims.GetExponent (slot);
+    ulong * n = (e > 0) ? num : den;
+    ulong   p = basePrimes.prime[slot];
+
+    for (e = (e > 0) ? e : -e; e > 0; e--)
+    {
+      if (*n > (ulong) -1 / p) return 0;
+      *n *= p;
+    }
+  }
+  return 1;
+}
+
+
+// take a unit out of everywhere it's listed.  (caller locks)
+// a base unit's slot is NOT given to the next base unit, since other
+// units may still have exponents in it.
+// any unit's build-up cache might mention this one, so void them all.
+void Unit::Unlist (void)
+{
+  int  slot;
+
+  if (! listed) return;
+  DelFrom (&knownUnits, ! builtIn);
+  DelFromIndexes();
+  GiveBackId();
+  listed = 0;
+  cacheEpoch++;
+  for (slot = 0; slot < baseCount; slot++)
+  {
+    if (baseUnits[slot] == this) baseUnits[slot] = NULL;
+  }
+}
+
+
 // set a unit's fields based on building it up from extant units
 void Unit::UnitBuildup (string n, Unit * u1, char op, Unit * u2)
 {
-  ulong  den;
-  ulong  num;
   if (op != '*' && op != '/') throw BadOperatorError (op);
-  CalcBuildupNumbers (u1, op, u2, &num, &den);
-  UnitInit (n, num, den);
+  UnitInit (n, CalcBuildupDims (u1, op, u2));
 }
 
 
-// do the main initialization of a new unit: set name, numerator, and
-// denominator, reduce to lowest terms, and add to list of known units.
-// TODO: check for name validity (if supplied, must not start w/ space),
-// and reuse (in which case, throw NameReuseError, TBW).
-void Unit::UnitInit (string n, ulong num, ulong den)
+// do the main initialization of a new unit: set name and dimension,
+// and add to list of known units.  (caller locks)
+// Names must not start with a space (those are reserved for temps),
+// and may not be reused for a different unit.  No name means a temp,
+// which just gets a number; see GetName.
+void Unit::UnitInit (string n, Dimension d)
 {
-  UnitIterator  it;
-  UnitIterator  unitsEnd = knownUnits.end();
+  int     i;
+  Unit *  old = NULL;
 
   if (n[0] == ' ') throw BadNameError (n);
-  else if (n != "") name = n;
-  else
+  ownName = n;
+  name = ownName;
+  tempNumber = (n == "") ? lastTemp++ : 0;
+  listed = 0;
+  pooled = 0;
+  builtIn = 0;
+  dims = d;
+  for (i = 0; i < BUILDUPCACHESIZE; i++)
   {
-    char  tmpStr[11];
-    name = " TEMP";
-    sprintf (tmpStr, "%lu", lastTemp++); // theoretically could overflow....
-    name += tmpStr;
+    buildupCache[i].seq.store (0, memory_order_relaxed);
+    buildupCache[i].epoch.store (0, memory_order_relaxed);
   }
-  numerator = num;
-  denominator = den;
-  Reduce();
-  for (it = knownUnits.begin(); it != unitsEnd; it++)
+  if (name != "") old = FindUnitByName (ownName);
+  if (old != NULL)
   {
-    if (name == (*it)->name)
+    // remove that one, not this, because we're called from constructor.
+    // we could throw error, but replacement is harmless.
+    if (*old == *this) old->Unlist();
+    else
     {
-      // remove that one, not this, because we're called from constructor.
-      // we could throw error, but replacement is harmless.
-      if (*(*it) == *this) knownUnits.remove (it);
-      else throw NameReuseError (name, num, den, *it);
-      break;
+      ulong  den;
+      ulong  num;
+
+      if (! GetNumbers (&num, &den)) num = den = 0;
+      throw NameReuseError (ownName, num, den, old);
     }
   }
+  TakeId();
   knownUnits.push_back (this);
+  STATS_HIGHWATER (knownUnits.size() + CATALOGUESIZE);
+  AddToIndexes();
+  listed = 1;
 }
 
 
 // Static methods
 
 
-// Calculate the numbers that would be the numerator and denominator,
-// of the unit that results from doing the indicated operation
-// on the given existing units.
-void Unit::CalcBuildupNumbers (Unit * u1, char op, Unit * u2,
-                              ulong * num, ulong *den)
+// Calculate the dimension of the unit that results from doing the
+// indicated operation on the given existing units.
+Dimension Unit::CalcBuildupDims (Unit * u1, char op, Unit * u2)
 {
-  *num = u1->numerator * ((op == '*') ? u2->numerator : u2->denominator);
-  *den = u1->denominator * ((op == '*') ? u2->denominator : u2->numerator);
-  Reduce (num, den);
+  Dimension  d;
+
+  if (! u1->dims.Buildup (op, u2->dims, &d)) throw OverflowError (u1);
+  return d;
 }
 
 
-// Find a unit by its numerator and denominator,
-// and if not found, create it
-Unit * Unit::FindOrMakeUnitByNumbers (ulong num, ulong den)
+// Find a unit by its dimension, and if not found, create it.
+// Finding needs no lock.  Making does, and then we have to look again,
+// in case another thread made it while we were waiting for the lock --
+// there must only ever be one temp unit per dimension.
+Unit * Unit::FindOrMakeUnitByDims (Dimension & d)
 {
-  Unit  * u = FindUnitByNumbers (num, den);
+  Unit  * u = FindUnitByDims (d);
+  if (u != NULL) return u;
+  STATS_TIME (STATS_MAKETEMP);
+  lock_guard <mutex>  lock (registryLock);
+  u = FindUnitByDims (d);
   if (u != NULL) return u;
-  else return new Unit ("", num, den);
+  u = new (AllocTemp()) Unit ("", d);
+  u->pooled = 1;
+  STATS_COUNT (STATS_TEMPSMADE);
+  return u;
 }
 
 
-// Find a unit by its numerator and denominator,
-// and if not found, return NULL
-Unit * Unit::FindUnitByNumbers (ulong num, ulong den)
+// Get room for a temp unit, from the arena: reclaimed room if there is
+// any, or else the next free spot in the latest chunk, or else a new
+// chunk.  (caller locks)
+void * Unit::AllocTemp (void)
 {
-  UnitIterator  it;
-  UnitIterator  unitsEnd = knownUnits.end();
+  static size_t  usedInChunk = TEMPCHUNKSIZE;
+  void *         p;
 
-  for (it = knownUnits.begin(); it != unitsEnd; it++)
+  if (! freeTemps.empty())
+  {
+    p = freeTemps.back();
+    freeTemps.pop_back();
+    return p;
+  }
+  if (usedInChunk == TEMPCHUNKSIZE)
   {
-    if ((*it)->numerator == num && (*it)->denominator == den) return *it;
+    tempChunks.push_back (::operator new (TEMPCHUNKSIZE * sizeof (Unit)));
+    usedInChunk = 0;
   }
-  return NULL;
+  return (char *) tempChunks.back() + sizeof (Unit) * usedInChunk++;
 }
 
 
-// print PART of a unit (either numerator or denominator),
-// in terms of what base units make it up
-string Unit::GetPartialBreakdown (ulong u)
+// make id i stand for Unit u.  (caller locks)
+void Unit::SetIdUnit (UnitId i, Unit * u)
 {
-  UnitIterator  basesEnd = baseUnits.end();
-  UnitIterator  it;
-  string        s = "";
+  atomic_ref <Unit *> (idChunks[i / IDCHUNKSIZE][i % IDCHUNKSIZE])
+    .store (u, memory_order_release);
+}
 
-  for (it = baseUnits.begin(); it != basesEnd; it++)
-  {
-    ulong num = (*it)->numerator;
-    if (u % num == 0)
-    {
-      int  i;
-      if (s != "") s += ' ';
-      s += (*it)->name;
-      for (i = 0; u % num == 0; i++) u /= num;
-      if (i > 1)
-      {
-        char  buf[6];
-        s += '^';
-        sprintf (buf, "%u", i);
-        s += buf;
-      }
-    }
-  }
-  return s;
+
+// Find a unit by its dimension, and if not found, return NULL
+Unit * Unit::FindUnitByDims (Dimension & d)
+{
+  Unit *  found = dimsIndex.Find (d.Hash(), [&d] (Unit * u)
+                                  {
+                                    return u->dims == d;
+                                  });
+
+  STATS_COUNT (STATS_LOOKUPS);
+  if (found == NULL) STATS_COUNT (STATS_LOOKUPMISSES);
+  return found;
 }
 
 
-// Reduce a numerator and denominator to lowest terms.
-// (Note: only divides by extant base units.  No other factors SHOULD
-// be able to creep in there, BUT....)
-void Unit::Reduce (ulong * num, ulong * den)
+// print a dimension in terms of what base units make it up: the ones
+// with positive exponents go in top, and negative ones in bottom.
+// (it's one pass over the slots, since there may be a lot of them.)
+void Unit::GetBreakdownParts (Dimension & d, string * top, string * bottom)
 {
-  UnitIterator  basesEnd = baseUnits.end();
-  UnitIterator  it;
+  int  slot;
 
-  for (it = baseUnits.begin(); it != basesEnd; it++)
+  *top = "";
+  *bottom = "";
+  for (slot = 0; slot < baseCount; slot++)
   {
-    ulong u = (*it)->numerator;
-    while (*num % u == 0 && *den % u == 0)
+    int       i = d.GetExponent (slot);
+    string *  s = (i > 0) ? top : bottom;
+
+    if (i == 0) continue;
+    if (i < 0) i = -i;
+    if (*s != "") *s += ' ';
+    // (a base unit that's been destroyed can still show up here)
+    if (baseUnits[slot] != NULL) *s += baseUnits[slot]->name;
+    else *s += "?";
+    if (i > 1)
     {
-      *num /= u;
-      *den /= u;
+      char  buf[12];
+      *s += '^';
+      sprintf (buf, "%d", i);
+      *s += buf;
     }
   }
 }
@@ -8,12 +8,30 @@ See also measure.*
 #ifndef UNIT_H
 #define UNIT_H
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
 #include <vector>
 #include <string>
+#include <string_view>
 using namespace std;
 
+#include "dimension.hpp"
+#include "unitindex.hpp"
+#include "unitstats.hpp"
 
-#define UNITNAMELEN 16
+
+// how many recent build-ups each Unit remembers; see FindUnitByBuildup
+#define BUILDUPCACHESIZE 8
+
+// how many temp Units to get room for at a time; see AllocTemp
+#define TEMPCHUNKSIZE 256
+
+// the table of Units by id (see UnitId) is IDCHUNKS chunks of
+// IDCHUNKSIZE, each one allocated when first needed
+#define IDCHUNKSIZE 4096
+#define IDCHUNKS 4096
 
 
 class Unit;
@@ -23,25 +41,81 @@ typedef UnitVector::iterator UnitIterator;
 
 typedef unsigned long ulong;
 
+// A Unit's id is a small number standing for its dimension: Units of the
+// same dimension have the same one, and Unit::FromId gives back one of
+// them (the first declared, or a named one rather than a temp).  Measures
+// keep these rather than Unit pointers.  0 is for no Unit.
+typedef uint32_t UnitId;
+
 class Unit
 {
 public:
   // Constructors
   Unit (string n);
   Unit (string  n, Unit *  u1, char  op, Unit *  u2);
+  // one of the standard Units, made by the compiler (only for unit.cpp;
+  // see the catalogue there)
+  struct CatalogueEntry
+  {
+    Unit *        unit;
+    const char *  name;
+    const char *  u1;     // by name
+    char          op;     // '*' or '/', or 0 for a base unit
+    const char *  u2;
+  };
+  consteval Unit (const CatalogueEntry & e);
   // Destructor
   ~Unit (void);
   // Member data -- NONE!
   // Member methods
   string  GetBreakdown (void);
-  string  GetName (void) { return name; }
+  Dimension  GetDimension (void) { return dims; }
+  constexpr UnitId  GetId (void) const noexcept { return id; }
+  string  GetName (void)
+          { return (name != "") ? string (name) : MakeTempName(); }
   Unit *  power (int pow);
   Unit *  root (int pow);
+  Unit *  TryPower (int pow);
+  Unit *  TryRoot (int pow);
   int operator == (Unit & u);
   int operator != (Unit & u) { return ! (*this == u); }
   // Static methods
-  static Unit * FindUnitByBuildup (Unit *  u1, char  op, Unit *  u2);
+  static Unit * FindUnitByBuildup (Unit *  u1, char  op, Unit *  u2)
+                {
+                  Unit *  u = TryBuildup (u1, op, u2);
+                  if (u == NULL) ThrowBuildupError (u1, op);
+                  return u;
+                }
+  static Unit * TryBuildup (Unit *  u1, char  op, Unit *  u2);
+  // (the same, by id)
+  static UnitId FindIdByBuildup (UnitId u1, char op, UnitId u2)
+                {
+                  return FindUnitByBuildup (FromId (u1), op, FromId (u2))->id;
+                }
+  // the Unit for an id; NULL for 0 (or for an id nobody has now, or
+  // that was never given out).  needs no lock.
+  static Unit * FromId (UnitId i) noexcept
+                {
+                  Unit **  c;
+
+                  if (i >= (UnitId) IDCHUNKS * IDCHUNKSIZE) return NULL;
+                  c = atomic_ref <Unit **> (idChunks[i / IDCHUNKSIZE])
+                        .load (memory_order_acquire);
+                  if (c == NULL) return NULL;
+                  return atomic_ref <Unit *> (c[i % IDCHUNKSIZE])
+                           .load (memory_order_acquire);
+                }
+  static Unit * FindUnitByName (string n);
+  static Unit * FindUnitByDimension (Dimension d);
+  static Unit * GetBaseUnit (int slot);
   static string GetAllBreakdowns (void);
+  static void   GetBuildupCacheStats (ulong * hits, ulong * misses);
+  static UnitStats  GetStats (void);
+  static void   SetStatsHook (StatsHook h, ulong every);
+  static ulong  GetEpoch (void)
+                { return cacheEpoch.load (memory_order_acquire); }
+  static size_t ReclaimTemps (UnitVector * inUse = NULL);
+  static constexpr size_t  HashName (string_view n);  // (see namesIndex)
   // Static data
   static Unit  UNITLESS;
   // Exception classes
@@ -49,13 +123,19 @@ public:
   {
   public:
     string name;
-    BadNameError (string n) { name = n; }
+    BadNameError (string n) { name = n; STATS_COUNT (STATS_EXCEPTIONS); }
   };
   class BadOperatorError
   {
   public:
     char op;
-    BadOperatorError (char c) { op = c; }
+    BadOperatorError (char c) { op = c; STATS_COUNT (STATS_EXCEPTIONS); }
+  };
+  class BaseUnitLimitError
+  {
+  public:
+    string name;
+    BaseUnitLimitError (string n) { name = n; STATS_COUNT (STATS_EXCEPTIONS); }
   };
   class BadRootError
   {
@@ -66,6 +146,7 @@ public:
     {
       unit = u;
       root = r;
+      STATS_COUNT (STATS_EXCEPTIONS);
     }
   };
   class MismatchError
@@ -76,6 +157,7 @@ public:
     {
       u1 = a;
       u2 = b;
+      STATS_COUNT (STATS_EXCEPTIONS);
     }
   };
   class NameReuseError
@@ -91,42 +173,109 @@ public:
       name = s;
       numerator = num;
       old = u;
+      STATS_COUNT (STATS_EXCEPTIONS);
     }
   };
   class NotFoundError
   {
   public:
     Unit *u;
-    NotFoundError (Unit * bad) { u = bad; }
+    NotFoundError (Unit * bad) { u = bad; STATS_COUNT (STATS_EXCEPTIONS); }
+  };
+  class OverflowError
+  {
+  public:
+    Unit *  unit;
+    OverflowError (Unit * u) { unit = u; STATS_COUNT (STATS_EXCEPTIONS); }
   };
 protected:
+  // one remembered build-up: this unit (op) partner = result.
+  // only good if epoch is still the current cacheEpoch.
+  // seq is odd while some thread is writing it; see FindUnitByBuildup.
+  struct BuildupCacheEntry
+  {
+    atomic <unsigned>  seq;
+    atomic <Unit *>    partner;
+    atomic <Unit *>    result;
+    atomic <ulong>     epoch;
+    atomic <char>      op;
+  };
   // Member data
-  string  name;
-  ulong   numerator;
-  ulong   denominator;
+  string_view        name;        // "" for temps; see GetName
+  string             ownName;     // name's storage (not the catalogue's)
+  Dimension          dims;
+  ulong              tempNumber;  // (only for temps)
+  char               listed;      // in the registry?
+  char               pooled;      // made by AllocTemp?
+  char               builtIn;     // one of the catalogue's?
+  UnitId             id;          // shared by Units of the same dims
+  BuildupCacheEntry  buildupCache[BUILDUPCACHESIZE];
+  // the first MAXBASEUNITS primes, sieved when compiling, so they're
+  // there before any Unit is made
+  struct PrimeTable
+  {
+    ulong  prime[MAXBASEUNITS];
+    constexpr PrimeTable (void);
+  };
   // Static data
-  static ulong       lastPrime; // see name-only constructor
-  static ulong       lastTemp;  // see no-name constructor (prot)
-  static UnitVector  knownUnits;
-  static UnitVector  baseUnits;
+  // Everything below that isn't atomic (including what's in the
+  // indexes) may only be changed while holding registryLock.  Lookups
+  // by dimension or name don't need it; see UnitIndex.
+  static mutex          registryLock;
+  static atomic <ulong> cacheEpoch; // bumped whenever a Unit goes away
+  static atomic <ulong> cacheHits;
+  static atomic <ulong> cacheMisses;
+  static ulong          lastTemp;   // see no-name constructor (prot)
+  static UnitVector     knownUnits; // all but the catalogue's
+  static array <Unit *, MAXBASEUNITS>  baseUnits;  // by slot; NULL if gone
+  static int            baseCount;  // slots used
+  static const PrimeTable  basePrimes; // by slot; see GetNumbers
+  static UnitIndex      dimsIndex;  // all Units, by dimension
+  static UnitIndex      namesIndex; // all Units, by name (not temps)
+  static vector <void *> tempChunks; // see AllocTemp
+  static vector <void *> freeTemps;
+  static Unit **        idChunks[IDCHUNKS]; // Units by id; see FromId
+  static UnitId         nextId;     // the next never-used id
+  static vector <UnitId> freeIds;   // ids given back by Units gone away
   // Constructors
-  Unit (string n, ulong num, ulong den) { UnitInit (n, num, den); }
+  Unit (string n, Dimension d) { UnitInit (n, d); }  // caller locks
   Unit (Unit * u1, char op, Unit * u2);
   // Other member methods
+  string  MakeBreakdown (void);
+  string  MakeTempName (void);
   void  DelFrom (UnitVector * v, char mustFind);
+  void  Unlist (void);
   void  UnitBuildup (string n, Unit * u1, char op, Unit * u2);
-  void  UnitInit (string n, ulong num, ulong den);
+  void  UnitInit (string n, Dimension d);
   void  CheckCompatibility (Unit & u);
-  void  Reduce (void) { Reduce (&numerator, &denominator); }
+  void  AddToIndexes (void);
+  void  DelFromIndexes (void);
+  void  TakeId (void);
+  void  GiveBackId (void);
+  int   GetNumbers (ulong * num, ulong * den);
   // Static methods
-  static void    CalcBuildupNumbers (Unit * u1, char op, Unit * u2,
-                                     ulong * num, ulong * den);
-  static Unit *  FindUnitByNumbers (ulong num, ulong den);
-  static Unit *  FindOrMakeUnitByNumbers (ulong num, ulong den);
-  static string  GetPartialBreakdown (ulong u);
-  static void    Reduce (ulong * num, ulong * den);
+  static Dimension  CalcBuildupDims (Unit * u1, char op, Unit * u2);
+  [[noreturn]] static void  ThrowBuildupError (Unit * u1, char op);
+  static Unit *     FindUnitByDims (Dimension & d);
+  static Unit *     FindOrMakeUnitByDims (Dimension & d);
+  static void *     AllocTemp (void);
+  static void       SetIdUnit (UnitId i, Unit * u);
+  static void       GetBreakdownParts (Dimension & d, string * top,
+                                       string * bottom);
 };
 
+
+// hash a unit name, for namesIndex.  (FNV-1a, so the compiler can do it
+// too, for the catalogue's part of the index.)
+constexpr size_t Unit::HashName (string_view n)
+{
+  unsigned long long  h = 0xcbf29ce484222325ULL;
+
+  for (char c : n) h = (h ^ (unsigned char) c) * 0x100000001b3ULL;
+  return (size_t) h;
+}
+
+
 #endif
 
 
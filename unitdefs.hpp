@@ -14,6 +14,7 @@ extern Unit WATT;
 extern Unit M2;
 extern Unit PASCAL;
 extern Unit AMPERE;
+extern Unit KELVIN;
 extern Unit VOLT;
 extern Unit OHM;
 
@@ -22,7 +23,11 @@ extern Unit FOOT;
 extern Unit YARD;
 extern Unit MILE;
 extern Unit SLUG;
+extern Unit FPS;
+extern Unit FPSPS;
 extern Unit POUND; // note that this is FORCE, NOT MASS!!!  It's a slug * G
 extern Unit FOOTPOUND;
+extern Unit FEETPERMETER;
+extern Unit SLUGSPERKILOGRAM;
 
 #endif
@@ -0,0 +1,279 @@
+/*
+unitindex.hpp (Copyright 2003 David J. Aronson)
+Open-addressing hash index of Units, used by Unit to find known units
+without walking the whole list.
+See also unit.*
+*/
+
+
+#ifndef UNITINDEX_H
+#define UNITINDEX_H
+
+#include <atomic>
+#include <stddef.h>
+#include <utility>
+using namespace std;
+
+
+class Unit;
+
+
+// Linear probing.  The caller supplies the hash, and a matcher for
+// lookups, so the same index type serves both the by-dimension and
+// by-name lookups.
+//
+// Find may be called from any number of threads at once, with no
+// locking, even while Add or Remove is running.  Add and Remove must
+// be serialized by the caller (Unit holds registryLock).  To make that
+// work, nothing a reader might be looking at is ever changed in place:
+// removed entries become tombstones (until the next rebuild), and when
+// the table fills up a new one is built and swapped in, with the old
+// one kept on the retired list until FreeRetired says nobody can still
+// be reading it.
+//
+// An index may also start out with a Prebuilt table, which the compiler
+// fills in, so that some units are there before any code runs at all.
+class UnitIndex
+{
+public:
+  template <size_t N> class Prebuilt;
+  // Constructors
+  // (no dynamic init, so it's usable before any Unit gets constructed)
+  constexpr UnitIndex (void) : table (NULL), count (0), used (0),
+                               retired (NULL) { }
+  template <size_t N>
+  constexpr UnitIndex (Prebuilt <N> & p, size_t n) : table (&p.table),
+                                                     count (n), used (n),
+                                                     retired (NULL) { }
+  // Destructor
+  ~UnitIndex (void);
+  // Member methods
+  size_t  GetCount (void) { return count; }
+  void    Add (Unit * u, size_t hash);
+  void    FreeRetired (void);
+  void    Remove (Unit * u, size_t hash);
+  template <class Matcher> Unit *  Find (size_t hash, Matcher matches);
+protected:
+  struct Slot
+  {
+    atomic <size_t>  hash;
+    atomic <Unit *>  unit;   // NULL if empty, Tombstone() if removed
+  };
+  struct Table
+  {
+    size_t   mask;     // table size minus one; size is a power of two
+    Slot *   slots;
+    Table *  next;     // next on the retired list
+    char     fixed;    // a Prebuilt one, which isn't ours to delete
+  };
+  // Member data
+  atomic <Table *>  table;
+  size_t            count;    // live entries
+  size_t            used;     // live entries plus tombstones
+  Table *           retired;
+  // Member methods
+  void  Rebuild (void);
+  // Static methods
+  static Table *  NewTable (size_t size);
+  static void     DeleteTable (Table * t);
+  static Unit *   Tombstone (void) { return (Unit *) 1; }
+};
+
+
+// N slots (N a power of two, and at least twice n), with the n given
+// units placed just as Add would place them.  It's consteval, so it can
+// only make a table the compiler fills in; it's never freed.  The
+// UnitIndex made from it is told n again.
+template <size_t N> class UnitIndex::Prebuilt
+{
+public:
+  // Constructors
+  consteval Prebuilt (const size_t * hashes, Unit * const * units, size_t n)
+            : Prebuilt (Place (hashes, units, n), make_index_sequence <N> ())
+            { }
+protected:
+  friend class UnitIndex;
+  struct Placed
+  {
+    size_t  hash[N];
+    Unit *  unit[N];
+  };
+  // Member data
+  Slot    slots[N];
+  Table   table;
+  // Constructors
+  template <size_t... I>
+  consteval Prebuilt (const Placed & p, index_sequence <I...>)
+            : slots { { p.hash[I], p.unit[I] }... },
+              table { N - 1, slots, NULL, 1 } { }
+  // Static methods
+  static consteval Placed  Place (const size_t * hashes,
+                                  Unit * const * units, size_t n)
+  {
+    Placed  p = { };
+    char    taken[N] = { };   // (units can't be compared to NULL here)
+    size_t  i;
+    size_t  j;
+
+    if ((N & (N - 1)) != 0 || n * 2 > N) throw "Prebuilt table too small";
+    for (i = 0; i < n; i++)
+    {
+      for (j = hashes[i] & (N - 1); taken[j]; j = (j + 1) & (N - 1)) { }
+      p.hash[j] = hashes[i];
+      p.unit[j] = units[i];
+      taken[j] = 1;
+    }
+    return p;
+  }
+};
+
+
+inline UnitIndex::~UnitIndex (void)
+{
+  FreeRetired();
+  if (table.load() != NULL) DeleteTable (table.load());
+}
+
+
+// Add a unit under a given hash.  Duplicates are the caller's problem.
+inline void UnitIndex::Add (Unit * u, size_t hash)
+{
+  Table *  t;
+  size_t   i;
+
+  // keep the load factor (tombstones included) at or below one half
+  t = table.load (memory_order_relaxed);
+  if (t == NULL || (used + 1) * 2 > t->mask + 1)
+  {
+    Rebuild();
+    t = table.load (memory_order_relaxed);
+  }
+  for (i = hash & t->mask; t->slots[i].unit.load (memory_order_relaxed);
+       i = (i + 1) & t->mask) { }
+  // the hash must be there before a reader can see the unit
+  t->slots[i].hash.store (hash, memory_order_relaxed);
+  t->slots[i].unit.store (u, memory_order_release);
+  count++;
+  used++;
+}
+
+
+// Find the first unit filed under hash, that the matcher accepts.
+template <class Matcher> Unit * UnitIndex::Find (size_t hash, Matcher matches)
+{
+  size_t   i;
+  Unit *   u;
+  Table *  t = table.load (memory_order_acquire);
+
+  if (t == NULL) return NULL;
+  for (i = hash & t->mask;
+       (u = t->slots[i].unit.load (memory_order_acquire)) != NULL;
+       i = (i + 1) & t->mask)
+  {
+    if (u != Tombstone() &&
+        t->slots[i].hash.load (memory_order_relaxed) == hash &&
+        matches (u)) return u;
+  }
+  return NULL;
+}
+
+
+// Free the tables that have been replaced.  Only call this when no
+// thread can be in the middle of a Find!
+inline void UnitIndex::FreeRetired (void)
+{
+  while (retired != NULL)
+  {
+    Table *  t = retired;
+    retired = t->next;
+    DeleteTable (t);
+  }
+}
+
+
+// Remove a specific unit (by pointer, not by match) filed under hash.
+inline void UnitIndex::Remove (Unit * u, size_t hash)
+{
+  size_t   i;
+  Unit *   v;
+  Table *  t = table.load (memory_order_relaxed);
+
+  if (t == NULL) return;
+  for (i = hash & t->mask;
+       (v = t->slots[i].unit.load (memory_order_relaxed)) != NULL;
+       i = (i + 1) & t->mask)
+  {
+    if (v == u)
+    {
+      t->slots[i].unit.store (Tombstone(), memory_order_release);
+      count--;
+      return;
+    }
+  }
+}
+
+
+// Build a new table with room to spare for the live entries (dropping
+// the tombstones), swap it in, and retire the old one.
+inline void UnitIndex::Rebuild (void)
+{
+  size_t   i;
+  Table *  old = table.load (memory_order_relaxed);
+  size_t   size = 64;
+  Table *  t;
+
+  while (size < (count + 1) * 4) size *= 2;
+  t = NewTable (size);
+  if (old != NULL)
+  {
+    for (i = 0; i <= old->mask; i++)
+    {
+      Unit *  u = old->slots[i].unit.load (memory_order_relaxed);
+      size_t  h = old->slots[i].hash.load (memory_order_relaxed);
+      size_t  j;
+
+      if (u == NULL || u == Tombstone()) continue;
+      for (j = h & t->mask; t->slots[j].unit.load (memory_order_relaxed);
+           j = (j + 1) & t->mask) { }
+      t->slots[j].hash.store (h, memory_order_relaxed);
+      t->slots[j].unit.store (u, memory_order_relaxed);
+    }
+    old->next = retired;
+    retired = old;
+  }
+  used = count;
+  table.store (t, memory_order_release);
+}
+
+
+// get an empty table of a given size
+inline UnitIndex::Table * UnitIndex::NewTable (size_t size)
+{
+  size_t   i;
+  Table *  t = new Table;
+
+  t->mask = size - 1;
+  t->slots = new Slot[size];
+  t->next = NULL;
+  t->fixed = 0;
+  for (i = 0; i < size; i++)
+  {
+    t->slots[i].hash.store (0, memory_order_relaxed);
+    t->slots[i].unit.store (NULL, memory_order_relaxed);
+  }
+  return t;
+}
+
+
+inline void UnitIndex::DeleteTable (Table * t)
+{
+  if (t->fixed) return;
+  delete [] t->slots;
+  delete t;
+}
+
+
+#endif // ifndef UNITINDEX_H
+
+
+// END OF FILE
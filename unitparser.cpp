@@ -0,0 +1,217 @@
+/*
+unitparser.cpp (Copyright 2003 David J. Aronson)
+Turning unit strings like "kg*m/s^2" or "foot-pound" into Units.
+See also unitparser.hpp, unit.*
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+
+#include "unitparser.hpp"
+#include "unitdefs.hpp"
+
+
+// NOTE: THESE ARE BEFORE THE BUILT-IN ALIASES BELOW ON PURPOSE
+mutex                           UnitParser::aliasLock;
+unordered_map <string, Unit *>  UnitParser::aliases;
+atomic <ulong>                  UnitParser::aliasEpoch (1);
+atomic <ulong>                  UnitParser::cacheHits (0);
+atomic <ulong>                  UnitParser::cacheMisses (0);
+
+
+// the usual abbreviations for the built-in Units
+static int AddBuiltInAliases (void)
+{
+  UnitParser::AddAlias ("s", &SECOND);
+  UnitParser::AddAlias ("sec", &SECOND);
+  UnitParser::AddAlias ("kg", &KILOGRAM);
+  UnitParser::AddAlias ("m", &METER);
+  UnitParser::AddAlias ("C", &COULOMB);
+  UnitParser::AddAlias ("N", &NEWTON);
+  UnitParser::AddAlias ("J", &JOULE);
+  UnitParser::AddAlias ("W", &WATT);
+  UnitParser::AddAlias ("Pa", &PASCAL);
+  UnitParser::AddAlias ("A", &AMPERE);
+  UnitParser::AddAlias ("V", &VOLT);
+  UnitParser::AddAlias ("K", &KELVIN);
+  UnitParser::AddAlias ("ft", &FOOT);
+  UnitParser::AddAlias ("feet", &FOOT);
+  UnitParser::AddAlias ("lbf", &POUND);
+  UnitParser::AddAlias ("ft-lb", &FOOTPOUND);
+  return 0;
+}
+static int  builtInAliases = AddBuiltInAliases();
+
+
+// PUBLIC STUFF
+
+
+// Static methods
+
+
+// the Unit a string stands for.  throws ParseError if it doesn't stand
+// for one, or the usual Unit exceptions (e.g., Unit::OverflowError for
+// "m^200").
+Unit * UnitParser::Parse (const string & s)
+{
+  static thread_local CacheEntry  cache[UNITSTRINGCACHESIZE];
+  size_t                          h = hash <string> () (s);
+  CacheEntry *                    c = &cache[h & (UNITSTRINGCACHESIZE - 1)];
+  ulong                           epoch = GetEpoch();
+  Unit *                          u;
+  size_t                          pos = 0;
+
+  if (c->epoch == epoch && c->hash == h && c->text == s)
+  {
+    cacheHits.fetch_add (1, memory_order_relaxed);
+    return c->unit;
+  }
+  cacheMisses.fetch_add (1, memory_order_relaxed);
+  // the whole thing might be a name, even with / or ^ in it, like "m/s^2"
+  u = FindName (s);
+  if (u == NULL)
+  {
+    u = ParseProduct (s, &pos);
+    SkipSpaces (s, &pos);
+    if (pos < s.size()) throw ParseError (s, pos, "expected * or /");
+  }
+  // (epoch is from before we looked, so if anything went away since,
+  // this entry is already no good)
+  c->text = s;
+  c->hash = h;
+  c->epoch = epoch;
+  c->unit = u;
+  return u;
+}
+
+
+// let another name stand for a Unit, e.g., AddAlias ("km/h", &KPH)
+void UnitParser::AddAlias (string alias, Unit * u)
+{
+  lock_guard <mutex>  lock (aliasLock);
+
+  aliases[alias] = u;
+  aliasEpoch++;
+}
+
+
+// how often Parse found the string in its thread's cache
+void UnitParser::GetCacheStats (ulong * hits, ulong * misses)
+{
+  *hits = cacheHits.load (memory_order_relaxed);
+  *misses = cacheMisses.load (memory_order_relaxed);
+}
+
+
+// PROTECTED STUFF
+
+
+// Static methods
+
+
+// a * b / c ...
+Unit * UnitParser::ParseProduct (const string & s, size_t * pos)
+{
+  Unit *  u = ParsePower (s, pos);
+
+  for (SkipSpaces (s, pos);
+       *pos < s.size() && (s[*pos] == '*' || s[*pos] == '/');
+       SkipSpaces (s, pos))
+  {
+    char  op = s[(*pos)++];
+    u = Unit::FindUnitByBuildup (u, op, ParsePower (s, pos));
+  }
+  return u;
+}
+
+
+// a name or (...), maybe raised to a whole power, e.g. s^-2
+Unit * UnitParser::ParsePower (const string & s, size_t * pos)
+{
+  Unit *  u;
+  long    n;
+  char *  end;
+
+  SkipSpaces (s, pos);
+  if (*pos < s.size() && s[*pos] == '(')
+  {
+    (*pos)++;
+    u = ParseProduct (s, pos);
+    SkipSpaces (s, pos);
+    if (*pos >= s.size() || s[*pos] != ')') throw ParseError (s, *pos,
+                                                              "expected )");
+    (*pos)++;
+  }
+  else u = ParseName (s, pos);
+  SkipSpaces (s, pos);
+  if (*pos >= s.size() || s[*pos] != '^') return u;
+  (*pos)++;
+  errno = 0;
+  n = strtol (s.c_str() + *pos, &end, 10);
+  if (end == s.c_str() + *pos) throw ParseError (s, *pos,
+                                                 "expected a whole number");
+  // (checked before it's made an int, so a huge one can't wrap around)
+  if (errno == ERANGE || n > MAXEXPONENT || n < -MAXEXPONENT)
+  {
+    throw ParseError (s, *pos, "power too big");
+  }
+  *pos = end - s.c_str();
+  return u->power (n);
+}
+
+
+// what ends a name: an operator, parenthesis, or space.  (not strchr on
+// a string of them, which would take a NUL for one too; a NUL is just
+// part of a name, which then won't be found)
+static inline int EndsName (char c)
+{
+  return c == '*' || c == '/' || c == '^' || c == '(' || c == ')' ||
+         c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+// a name: anything up to an operator, parenthesis, or space
+Unit * UnitParser::ParseName (const string & s, size_t * pos)
+{
+  size_t  start = *pos;
+  Unit *  u;
+
+  while (*pos < s.size() && ! EndsName (s[*pos])) (*pos)++;
+  if (*pos == start) throw ParseError (s, start, "expected a unit name");
+  if (*pos - start == 1 && s[start] == '1') return &Unit::UNITLESS;
+  u = FindName (s.substr (start, *pos - start));
+  if (u == NULL) throw ParseError (s, start, "unknown unit name");
+  return u;
+}
+
+
+// an alias or a Unit's name, or NULL if it's neither
+Unit * UnitParser::FindName (const string & name)
+{
+  {
+    lock_guard <mutex>                        lock (aliasLock);
+    unordered_map <string, Unit *>::iterator  it = aliases.find (name);
+
+    if (it != aliases.end()) return it->second;
+  }
+  return Unit::FindUnitByName (name);
+}
+
+
+void UnitParser::SkipSpaces (const string & s, size_t * pos)
+{
+  while (*pos < s.size() && s[*pos] && strchr (" \t\r\n", s[*pos])) (*pos)++;
+}
+
+
+// changes whenever a cached answer might be wrong: a Unit went away, or
+// an alias was added.  (both only go up, so neither can undo the other.)
+ulong UnitParser::GetEpoch (void)
+{
+  return Unit::GetEpoch() + aliasEpoch.load (memory_order_acquire);
+}
+
+
+// END OF FILE
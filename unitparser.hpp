@@ -0,0 +1,81 @@
+/*
+unitparser.hpp (Copyright 2003 David J. Aronson)
+Turning unit strings like "kg*m/s^2" or "foot-pound" into Units.
+See also unitparser.cpp, unit.*
+*/
+
+#ifndef UNITPARSER_H
+#define UNITPARSER_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "unit.hpp"
+
+using namespace std;
+
+
+// how many strings each thread remembers the Units of; a power of two
+#define UNITSTRINGCACHESIZE 1024
+
+
+// A unit string is either the name of a known Unit (or an alias for
+// one, like "kg"), or a product of them: names (or parenthesized unit
+// strings), each optionally raised to a whole power with ^, joined by
+// * and /, left to right.  E.g. "kg*m/s^2", "N*m", "ft/(s*s)", "s^-1".
+// "1" is unitless, so "1/s" works too.
+//
+// Parsing goes through the registry, but each thread remembers the
+// strings it has parsed lately, so a string seen before costs one hash
+// lookup.  What it remembers is forgotten if any Unit goes away (see
+// Unit::GetEpoch) or an alias is added.
+class UnitParser
+{
+public:
+  // Static methods
+  static Unit *  Parse (const string & s);
+  static void    AddAlias (string alias, Unit * u);
+  static void    GetCacheStats (ulong * hits, ulong * misses);
+  // Exception classes
+  class ParseError
+  {
+  public:
+    string  text;
+    size_t  pos;      // where in text it went wrong
+    string  problem;
+    ParseError (string t, size_t p, string s)
+    {
+      text = t;
+      pos = p;
+      problem = s;
+    }
+  };
+protected:
+  struct CacheEntry
+  {
+    string  text;
+    size_t  hash;
+    ulong   epoch;     // 0 if unused
+    Unit *  unit;
+  };
+  // Static data
+  static mutex                            aliasLock;
+  static unordered_map <string, Unit *>   aliases;
+  static atomic <ulong>                   aliasEpoch;   // bumped by AddAlias
+  static atomic <ulong>                   cacheHits;
+  static atomic <ulong>                   cacheMisses;
+  // Static methods
+  static Unit *  ParseProduct (const string & s, size_t * pos);
+  static Unit *  ParsePower (const string & s, size_t * pos);
+  static Unit *  ParseName (const string & s, size_t * pos);
+  static Unit *  FindName (const string & name);
+  static void    SkipSpaces (const string & s, size_t * pos);
+  static ulong   GetEpoch (void);
+};
+
+
+#endif // ifndef UNITPARSER_H
+
+
+// END OF FILE
@@ -0,0 +1,144 @@
+/*
+unitstats.cpp (Copyright 2003 David J. Aronson)
+Counting what the hot paths of Unit and Measure do, and timing a sample
+of the slow ones, when compiled with -DMEASURE_STATS.
+See also unitstats.hpp, unit.*
+*/
+
+#include <string.h>
+
+#include "unitstats.hpp"
+
+
+mutex                        Stats::blocksLock;
+Stats::Block *               Stats::allBlocks = NULL;
+Stats::Block *               Stats::freeBlocks = NULL;
+pthread_key_t                Stats::exitKey;
+int                          Stats::exitKeyMade = 0;
+atomic <StatsHook>           Stats::hook (NULL);
+atomic <ulong>               Stats::every (1);
+atomic <ulong>               Stats::highWater (0);
+
+
+// PUBLIC STUFF
+
+
+// Static methods
+
+
+// note how many Units there are now (caller holds the registry lock)
+void Stats::HighWater (ulong n)
+{
+  if (n > highWater.load (memory_order_relaxed))
+  {
+    highWater.store (n, memory_order_relaxed);
+  }
+}
+
+
+// add up every thread's counts
+void Stats::Sum (UnitStats * s)
+{
+  lock_guard <mutex>  lock (blocksLock);
+  Block *             b;
+  int                 i;
+
+  memset (s, 0, sizeof (*s));
+  for (b = allBlocks; b != NULL; b = b->nextAll)
+  {
+    for (i = 0; i < STATS_COUNTERS; i++)
+    {
+      s->count[i] += b->count[i].load (memory_order_relaxed);
+    }
+  }
+  s->registryHighWater = highWater.load (memory_order_relaxed);
+}
+
+
+// have h told how long one in every e events (per thread) takes;
+// NULL stops it
+void Stats::SetHook (StatsHook h, ulong e)
+{
+  every.store ((e == 0) ? 1 : e, memory_order_relaxed);
+  hook.store (h, memory_order_relaxed);
+}
+
+
+// whether to time this event: one in every "every", in this thread
+int Stats::Sample (void)
+{
+  static thread_local ulong  n = 0;
+
+  return ++n % every.load (memory_order_relaxed) == 0;
+}
+
+
+// what a counter's called, for printing
+const char * Stats::GetName (int c)
+{
+  static const char *  names[STATS_COUNTERS] =
+  {
+    "adds", "subs", "muls", "divs", "powers", "roots", "assigns", "compares",
+    "checkunits", "lookups", "lookupmisses", "tempsmade", "tempsreclaimed",
+    "exceptions"
+  };
+
+  return (c >= 0 && c < STATS_COUNTERS) ? names[c] : "?";
+}
+
+
+// PROTECTED STUFF
+
+
+// Static methods
+
+
+// give this thread a Block: one an exited thread gave back, or a new
+// one.  a pthread key (rather than a thread_local with a destructor,
+// which static Units' destructors could outlive) gets it back at exit.
+Stats::Block * Stats::NewLocal (void)
+{
+  Block *  b;
+
+  {
+    lock_guard <mutex>  lock (blocksLock);
+    int                 i;
+
+    if (! exitKeyMade)
+    {
+      pthread_key_create (&exitKey, FreeLocal);
+      exitKeyMade = 1;
+    }
+    if (freeBlocks != NULL)
+    {
+      b = freeBlocks;
+      freeBlocks = b->nextFree;
+    }
+    else
+    {
+      b = new Block;
+      for (i = 0; i < STATS_COUNTERS; i++) b->count[i].store (0);
+      b->nextAll = allBlocks;
+      allBlocks = b;
+    }
+  }
+  local = b;
+  pthread_setspecific (exitKey, b);
+  return b;
+}
+
+
+// a thread is done with its Block.  (if it counts anything more on the
+// way out, it just gets another.)
+void Stats::FreeLocal (void * p)
+{
+  Block *             b = (Block *) p;
+  lock_guard <mutex>  lock (blocksLock);
+
+  b->nextFree = freeBlocks;
+  freeBlocks = b;
+  local = NULL;
+}
+
+
+// END OF FILE
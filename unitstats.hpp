@@ -0,0 +1,154 @@
+/*
+unitstats.hpp (Copyright 2003 David J. Aronson)
+Counting what the hot paths of Unit and Measure do, and timing a sample
+of the slow ones, when compiled with -DMEASURE_STATS.
+See also unitstats.cpp, unit.*
+*/
+
+#ifndef UNITSTATS_H
+#define UNITSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <pthread.h>
+
+using namespace std;
+
+typedef unsigned long ulong;
+
+
+// what's counted
+enum StatsCounter
+{
+  STATS_ADDS, STATS_SUBS, STATS_MULS, STATS_DIVS, STATS_POWERS, STATS_ROOTS,
+  STATS_ASSIGNS, STATS_COMPARES,  // Measure operations, by kind
+  STATS_CHECKUNITS,               // Measure unit checks
+  STATS_LOOKUPS,                  // registry lookups, by dimension or name
+  STATS_LOOKUPMISSES,             // ...that found nothing
+  STATS_TEMPSMADE,
+  STATS_TEMPSRECLAIMED,
+  STATS_EXCEPTIONS,               // Unit exceptions (Measure's are Unit's)
+  STATS_COUNTERS                  // (how many there are)
+};
+
+// what's timed, for the hook
+enum StatsEvent
+{
+  STATS_BUILDUP,                  // FindUnitByBuildup (so Measure * and /)
+  STATS_FINDBYNAME,
+  STATS_MAKETEMP,                 // the locked part of making a temp Unit
+  STATS_RECLAIM                   // ReclaimTemps
+};
+
+// told how long an event took, for one in every so many events
+typedef void (*StatsHook) (StatsEvent e, double ns);
+
+// a snapshot of the counts, from Unit::GetStats
+struct UnitStats
+{
+  int    enabled;                 // 0 if not compiled with MEASURE_STATS
+  ulong  count[STATS_COUNTERS];   // summed over all threads, ever
+  ulong  registryHighWater;       // most Units there have been at once
+};
+
+
+// Each thread counts in its own Block, so counting is a plain add to
+// memory no other thread writes.  The counts are atomic only so that
+// GetStats may read them while their thread is still going; they're
+// relaxed, so a snapshot may be a count or two behind.  A thread's Block
+// is given to the next new thread when it exits, and the counts carry
+// on, so the sums never lose anything.
+class Stats
+{
+public:
+  // Static methods
+  static void         Count (StatsCounter c, ulong n)
+                      {
+                        atomic <ulong> &  a = GetLocal()->count[c];
+                        a.store (a.load (memory_order_relaxed) + n,
+                                 memory_order_relaxed);
+                      }
+  static void         HighWater (ulong n);
+  static void         Sum (UnitStats * s);
+  static void         SetHook (StatsHook h, ulong every);
+  static StatsHook    GetHook (void)
+                      { return hook.load (memory_order_relaxed); }
+  static int          Sample (void);
+  static const char * GetName (int c);
+protected:
+  struct Block
+  {
+    atomic <ulong>  count[STATS_COUNTERS];
+    Block *         nextAll;
+    Block *         nextFree;
+  };
+  // Static data
+  // (all constant-initialized, so they're good even while other files'
+  // static Units are being made)
+  static inline thread_local Block *  local = NULL;  // this thread's
+  static mutex                 blocksLock;
+  static Block *               allBlocks;
+  static Block *               freeBlocks;  // given back by exited threads
+  static pthread_key_t         exitKey;     // see NewLocal
+  static int                   exitKeyMade;
+  static atomic <StatsHook>    hook;
+  static atomic <ulong>        every;
+  static atomic <ulong>        highWater;
+  // Static methods
+  static Block *  GetLocal (void)
+                  { return (local != NULL) ? local : NewLocal(); }
+  static Block *  NewLocal (void);
+  static void     FreeLocal (void * b);
+};
+
+
+// Times an event, from when it's made till it goes away, if there's a
+// hook and this is one of the events to sample.  Otherwise it costs a
+// load of the hook.
+class StatsTimer
+{
+public:
+  // Constructors
+  StatsTimer (StatsEvent e)
+  {
+    event = e;
+    timing = Stats::GetHook() != NULL && Stats::Sample();
+    if (timing) start = chrono::steady_clock::now();
+  }
+  // Destructor
+  ~StatsTimer (void)
+  {
+    StatsHook  h = Stats::GetHook();
+
+    if (! timing || h == NULL) return;
+    h (event, chrono::duration <double, nano>
+              (chrono::steady_clock::now() - start).count());
+  }
+protected:
+  // Member data
+  StatsEvent                            event;
+  int                                   timing;
+  chrono::steady_clock::time_point      start;
+};
+
+
+// what the rest of the code uses, so it all goes away without
+// MEASURE_STATS
+#ifdef MEASURE_STATS
+#define STATS_COUNT(c)      Stats::Count (c, 1)
+#define STATS_ADD(c, n)     Stats::Count (c, n)
+#define STATS_HIGHWATER(n)  Stats::HighWater (n)
+#define STATS_TIME(e)       StatsTimer  statsTimer (e)
+#else
+#define STATS_COUNT(c)      ((void) 0)
+#define STATS_ADD(c, n)     ((void) 0)
+#define STATS_HIGHWATER(n)  ((void) 0)
+#define STATS_TIME(e)       ((void) 0)
+#endif
+
+
+#endif // ifndef UNITSTATS_H
+
+
+// END OF FILE